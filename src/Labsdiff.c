@@ -0,0 +1,31 @@
+/**
+*  @file
+*  Labsdiff - a Max object to generate the absolute difference of two or more lists
+*
+*  The element-wise engine is in Lelem.c, the operator is defined below.
+*/
+
+/****************************************************************
+*  Header files
+*/
+#include "ext.h"
+#include "ext_obex.h"
+#include "Lobjects.h"
+#include "Lelem.h"
+
+/****************************************************************
+*  Operator definition
+*/
+#define LELEM_OP_LONG(a, b, k)   (((a) > (b)) ? (a) - (b) : (b) - (a))
+#define LELEM_OP_FLOAT(a, b, k)  (((a) > (b)) ? (a) - (b) : (b) - (a))
+#define LELEM_INT_OUTPUT         1
+
+#include "Lelem_kernel.h"
+
+/****************************************************************
+*  Initialization
+*/
+void ext_main(void *r)
+{
+  lelem_class_new("Labsdiff", "absolute difference of the input lists (list)", 2);
+}
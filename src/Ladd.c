@@ -0,0 +1,31 @@
+/**
+*  @file
+*  Ladd - a Max object to add two or more lists
+*
+*  The element-wise engine is in Lelem.c, the operator is defined below.
+*/
+
+/****************************************************************
+*  Header files
+*/
+#include "ext.h"
+#include "ext_obex.h"
+#include "Lobjects.h"
+#include "Lelem.h"
+
+/****************************************************************
+*  Operator definition
+*/
+#define LELEM_OP_LONG(a, b, k)   ((a) + (b))
+#define LELEM_OP_FLOAT(a, b, k)  ((a) + (b))
+#define LELEM_INT_OUTPUT         1
+
+#include "Lelem_kernel.h"
+
+/****************************************************************
+*  Initialization
+*/
+void ext_main(void *r)
+{
+  lelem_class_new("Ladd", "sum of the input lists (list)", 2);
+}
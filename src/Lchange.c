@@ -9,10 +9,21 @@
 *    - The external uses the new style Max object and attributes.
 *    - The arrays to store lists and messages are resizable.
 *    - Non int, float or list messages can be processed (starting with a symbol).
+*    - The stored list can be shared between objects without copies:  publish <name> / share <name>
 *
 *  Notes: 
 *    Int and float atoms with similar values are considered equal.
 *    Truncated and full length lists are considered unequal.
+*    Numbers are equal if |a - b| <= tol_abs + tol_rel * max(|a|, |b|).
+*    Infinities are only equal to themselves, and NaN is never equal.
+*    With the history attribute, the last distinct lists are also matched,
+*    and with the hit_index attribute, the index of the matching list is sent
+*    out of the third outlet.
+*    With the changes attribute, the positions that differ from the stored list
+*    are sent out of the right outlet, as a list of indexes or as a bitmask
+*    packed in signed ints of 32 bits, before a different list is output.
+*    With the inbox attribute, the stored list can be sent from another thread,
+*    and the newest one is applied at the next input in the left inlet.
 */
 
 /****************************************************************
@@ -21,6 +32,7 @@
 #include "ext.h"
 #include "ext_obex.h"
 #include "Lobjects.h"
+#include <math.h>
 
 /****************************************************************
 *  Max object structure
@@ -32,19 +44,51 @@ typedef struct _lchange
   // Inlets, proxies and outlets
   void *inl_proxy;
   long  inl_proxy_ind;
+  void *outl_changes;
+  void *outl_index;
   void *outl_list_same;
   void *outl_list_diff;
 
-  // Input message
+  // Input message, and inbox for the lists sent from another thread
   t_mess_struct i_list_2[1];
+  t_mess_inbox  inbox_2[1];
+  t_symbol     *i_pub;     // name the stored list is published under, or NULL
+
+  // Output message for the changed positions
+  t_mess_struct o_changes[1];
+
+  // Copy of the stored list in compact words, if all its atoms can be stored, for the compare loops
+  t_mess_compact i_packed[1];
+  t_bool         is_packed;
+
+  // History of the last distinct lists, with their hashes and time of last use
+  t_mess_struct *h_lists;
+  t_uint32      *h_hashes;
+  t_uint64      *h_stamps;
+  t_uint64       h_clock;
+  t_int32        h_cnt;
+
+  // Lazy allocation:  true until the lists are allocated on first use
+  t_bool alloc_pending;
 
   // Attributes
   t_mess_int maxlen;     // maximum list length
   char       warnings;   // report warnings or not
   char       is_locked;  // lock or unlock the stored string
+  double     tol_abs;    // absolute tolerance to compare numbers
+  double     tol_rel;    // relative tolerance to compare numbers
+  t_int32    history;    // number of lists in the history
+  char       changes;    // output the changed positions:  0: off - 1: indexes - 2: bitmask
+  char       inbox;      // post the stored lists to the inbox
+  char       hit_index;  // output the index of the matching list in the history
 
 } t_lchange;
 
+/****************************************************************
+*  Preprocessor macros
+*/
+#define HISTORY_MAX 256
+
 /****************************************************************
 *  Global class pointer
 */
@@ -63,12 +107,34 @@ void  lchange_float    (t_lchange *x, double f);
 void  lchange_list     (t_lchange *x, t_symbol *sym, long argc, t_atom *argv);
 void  lchange_anything (t_lchange *x, t_symbol *sym, long argc, t_atom *argv);
 void  lchange_clear    (t_lchange *x);
+void  lchange_publish  (t_lchange *x, t_symbol *name);
+void  lchange_share    (t_lchange *x, t_symbol *name);
 void  lchange_post     (t_lchange *x);
 
+void  lchange_pack     (t_lchange *x);
+t_mess lchange_target  (t_lchange *x);
+void  lchange_stored   (t_lchange *x);
+t_bool nums_diff       (t_lchange *x, double f1, double f2);
+t_bool atoms_diff      (t_lchange *x, t_atom *atom1, t_atom *atom2);
+t_bool word_diff       (t_lchange *x, t_mess_word word, t_atom *atom);
+t_bool lchange_match   (t_lchange *x, t_mess mess, t_mess_word *words, t_symbol *sym, long argc, t_atom *argv, char offset);
+t_bool lchange_match_changes (t_lchange *x, t_symbol *sym, long argc, t_atom *argv, char offset);
+t_uint32 lchange_hash  (t_symbol *sym, long argc, t_atom *argv, char offset);
+t_int32 lchange_history_find (t_lchange *x, t_uint32 hash, t_symbol *sym, long argc, t_atom *argv, char offset);
+void  lchange_history_add    (t_lchange *x, t_uint32 hash, t_symbol *sym, long argc, t_atom *argv, char offset);
+t_max_err lchange_history_alloc (t_lchange *x, t_int32 history, t_mess_int maxlen);
 void  lchange_action   (t_lchange *x, t_symbol *sym, long argc, t_atom *argv, char offset);
 void  lchange_output   (t_lchange *x);
 
-t_max_err lchange_maxlen_set (t_lchange *x, void *attr, long argc, t_atom *argv);
+t_max_err lchange_alloc       (t_lchange *x);
+t_max_err lchange_maxlen_set  (t_lchange *x, void *attr, long argc, t_atom *argv);
+t_max_err lchange_history_set (t_lchange *x, void *attr, long argc, t_atom *argv);
+t_max_err lchange_inbox_set   (t_lchange *x, void *attr, long argc, t_atom *argv);
+
+/****************************************************************
+*  Allocation function called by ASSERT_ALLOC
+*/
+#define ALLOC_FUNCTION lchange_alloc
 
 /****************************************************************
 *  Initialization
@@ -94,6 +160,8 @@ void ext_main(void *r)
   class_addmethod(c, (method)lchange_anything, "anything",  A_GIMME, 0);
   class_addmethod(c, (method)stdinletinfo,     "inletinfo", A_CANT,  0);
   class_addmethod(c, (method)lchange_clear,    "clear",              0);
+  class_addmethod(c, (method)lchange_publish,  "publish",   A_SYM,   0);
+  class_addmethod(c, (method)lchange_share,    "share",     A_SYM,   0);
   class_addmethod(c, (method)lchange_post,     "post",               0);
 
   // Define the class attributes
@@ -119,6 +187,51 @@ void ext_main(void *r)
   CLASS_ATTR_FILTER_CLIP(c, "lock", 0, 1);
   CLASS_ATTR_SAVE     (c, "lock", 0);
   CLASS_ATTR_SELFSAVE (c, "lock", 0);
+
+  CLASS_ATTR_DOUBLE   (c, "tol_abs", 0, t_lchange, tol_abs);
+  CLASS_ATTR_ORDER    (c, "tol_abs", 0, "4");
+  CLASS_ATTR_LABEL    (c, "tol_abs", 0, "absolute tolerance");
+  CLASS_ATTR_FILTER_MIN(c, "tol_abs", 0);
+  CLASS_ATTR_SAVE     (c, "tol_abs", 0);
+  CLASS_ATTR_SELFSAVE (c, "tol_abs", 0);
+
+  CLASS_ATTR_DOUBLE   (c, "tol_rel", 0, t_lchange, tol_rel);
+  CLASS_ATTR_ORDER    (c, "tol_rel", 0, "5");
+  CLASS_ATTR_LABEL    (c, "tol_rel", 0, "relative tolerance");
+  CLASS_ATTR_FILTER_MIN(c, "tol_rel", 0);
+  CLASS_ATTR_SAVE     (c, "tol_rel", 0);
+  CLASS_ATTR_SELFSAVE (c, "tol_rel", 0);
+
+  CLASS_ATTR_INT32    (c, "history", 0, t_lchange, history);
+  CLASS_ATTR_ORDER    (c, "history", 0, "6");
+  CLASS_ATTR_LABEL    (c, "history", 0, "number of lists in the history");
+  CLASS_ATTR_SAVE     (c, "history", 0);
+  CLASS_ATTR_SELFSAVE (c, "history", 0);
+  CLASS_ATTR_ACCESSORS(c, "history", NULL, lchange_history_set);
+
+  CLASS_ATTR_CHAR     (c, "changes", 0, t_lchange, changes);
+  CLASS_ATTR_ORDER    (c, "changes", 0, "7");
+  CLASS_ATTR_ENUMINDEX(c, "changes", 0, "off indexes bitmask");
+  CLASS_ATTR_LABEL    (c, "changes", 0, "output the changed positions");
+  CLASS_ATTR_FILTER_CLIP(c, "changes", 0, 2);
+  CLASS_ATTR_SAVE     (c, "changes", 0);
+  CLASS_ATTR_SELFSAVE (c, "changes", 0);
+
+  CLASS_ATTR_CHAR     (c, "inbox", 0, t_lchange, inbox);
+  CLASS_ATTR_ORDER    (c, "inbox", 0, "8");
+  CLASS_ATTR_STYLE    (c, "inbox", 0, "onoff");
+  CLASS_ATTR_LABEL    (c, "inbox", 0, "apply cold inputs at next hot input");
+  CLASS_ATTR_SAVE     (c, "inbox", 0);
+  CLASS_ATTR_SELFSAVE (c, "inbox", 0);
+  CLASS_ATTR_ACCESSORS(c, "inbox", NULL, lchange_inbox_set);
+
+  CLASS_ATTR_CHAR     (c, "hit_index", 0, t_lchange, hit_index);
+  CLASS_ATTR_ORDER    (c, "hit_index", 0, "9");
+  CLASS_ATTR_STYLE    (c, "hit_index", 0, "onoff");
+  CLASS_ATTR_LABEL    (c, "hit_index", 0, "output the index of history matches");
+  CLASS_ATTR_FILTER_CLIP(c, "hit_index", 0, 1);
+  CLASS_ATTR_SAVE     (c, "hit_index", 0);
+  CLASS_ATTR_SELFSAVE (c, "hit_index", 0);
   
   // Register the class
   class_register(CLASS_BOX, c);
@@ -141,6 +254,8 @@ void *lchange_new(t_symbol *sym, long argc, t_atom *argv)
   // Set inlets, outlets and proxies
   x->inl_proxy_ind = 0;
   x->inl_proxy = proxy_new((t_object *)x, 1L, &x->inl_proxy_ind);
+  x->outl_changes = outlet_new((t_object *)x, NULL);
+  x->outl_index = intout((t_object *)x);
   x->outl_list_same = outlet_new((t_object *)x, NULL);
   x->outl_list_diff = outlet_new((t_object *)x, NULL);
 
@@ -148,9 +263,26 @@ void *lchange_new(t_symbol *sym, long argc, t_atom *argv)
   x->maxlen = 0;
   x->warnings = 1;
   x->is_locked = 1;
+  x->tol_abs = 0;
+  x->tol_rel = 0;
+  x->history = 0;
+  x->changes = 0;
+  x->inbox = 0;
+  x->hit_index = 0;
 
   // Initialize the message structures
   mess_init(x->i_list_2);
+  inbox_init(x->inbox_2);
+  x->i_pub = NULL;
+  mess_init(x->o_changes);
+  compact_init(x->i_packed);
+  x->is_packed = false;
+  x->h_lists = NULL;
+  x->h_hashes = NULL;
+  x->h_stamps = NULL;
+  x->h_clock = 0;
+  x->h_cnt = 0;
+  x->alloc_pending = false;
 
   // Process the attribute arguments
   attr_args_process(x, (short)argc, argv);
@@ -164,9 +296,10 @@ void *lchange_new(t_symbol *sym, long argc, t_atom *argv)
 
   // Process the non attribute arguments to set the left input list if necessary
   argc = (t_mess_int)attr_args_offset((short)argc, argv);
-  if (argc) {
+  if (argc && (!x->alloc_pending || (lchange_alloc(x) == MAX_ERR_NONE))) {
     mess_set_list(x->i_list_2, argc, argv, x, x->warnings);
     mess_set_type(x->i_list_2);    // determine the proper symbol (int, float, list, message)
+    lchange_pack(x);
   }
  
   return x;
@@ -183,7 +316,12 @@ void lchange_free(t_lchange *x)
   freeobject((t_object *)x->inl_proxy);
 
   // Free the message structures
+  mess_unpublish(x->i_list_2);
   mess_clear(x->i_list_2);
+  inbox_clear(x->inbox_2);
+  mess_clear(x->o_changes);
+  compact_clear(x->i_packed);
+  lchange_history_alloc(x, 0, 0);
 }
 
 /****************************************************************
@@ -203,6 +341,8 @@ void lchange_assist(t_lchange *x, void *b, long msg, long arg, char *dst)
     switch (arg) {
     case 0: sprintf(dst, "if list is different (list)"); break;
     case 1: sprintf(dst, "if list is the same (list)"); break;
+    case 2: sprintf(dst, "index of the matching list in the history (int)"); break;
+    case 3: sprintf(dst, "changed positions, as indexes or bitmask (list)"); break;
     default: break;
     }
     break;
@@ -233,7 +373,7 @@ void lchange_int(t_lchange *x, t_atom_long n)
 
   switch (proxy_getinlet((t_object *)x)) {
   case 0: lchange_action(x, sym_int, 1, atom, 0); break;
-  case 1: mess_set_int(x->i_list_2, atom, x, x->warnings); break;
+  case 1: mess_set_int(lchange_target(x), atom, x, x->warnings); lchange_stored(x); break;
   }
 }
 
@@ -251,7 +391,7 @@ void lchange_float(t_lchange *x, double f)
 
   switch (proxy_getinlet((t_object *)x)) {
   case 0: lchange_action(x, sym_float, 1, atom, 0); break;
-  case 1: mess_set_float(x->i_list_2, atom, x, x->warnings); break;
+  case 1: mess_set_float(lchange_target(x), atom, x, x->warnings); lchange_stored(x); break;
   }
 }
 
@@ -266,7 +406,7 @@ void lchange_list(t_lchange *x, t_symbol *sym, long argc, t_atom *argv)
 
   switch (proxy_getinlet((t_object *)x)) {
   case 0: lchange_action(x, sym_list, argc, argv, 0); break;
-  case 1: mess_set_list(x->i_list_2, argc, argv, x, x->warnings); break;
+  case 1: mess_set_list(lchange_target(x), argc, argv, x, x->warnings); lchange_stored(x); break;
   }
 }
 
@@ -281,8 +421,46 @@ void lchange_anything(t_lchange *x, t_symbol *sym, long argc, t_atom *argv)
 
   switch (proxy_getinlet((t_object *)x)) {
   case 0: lchange_action(x, sym, argc, argv, 1); break;
-  case 1: mess_set_any(x->i_list_2, sym, argc, argv, x, x->warnings); break;
+  case 1: mess_set_any(lchange_target(x), sym, argc, argv, x, x->warnings); lchange_stored(x); break;
+  }
+}
+
+/****************************************************************
+*  Publish the stored list under a name, for other objects to share it
+*
+*  The list is only published while it is allocated:  it is unpublished
+*  when maxlen changes, and published again once it is reallocated.
+*/
+void lchange_publish(t_lchange *x, t_symbol *name)
+{
+  TRACE("lchange_publish");
+
+  ASSERT_ALLOC;
+
+  mess_unpublish(x->i_list_2);
+  x->i_pub = (name != gensym("")) ? name : NULL;
+  if (x->i_pub) { mess_publish(x->i_list_2, x->i_pub); }
+}
+
+/****************************************************************
+*  Share the stored list published by another object, without copying it
+*
+*  Each object copies the list when it is modified.
+*/
+void lchange_share(t_lchange *x, t_symbol *name)
+{
+  TRACE("lchange_share");
+
+  ASSERT_ALLOC;
+
+  t_mess src = mess_published(name);
+  if (!src) { ERR("share:  No list published as \"%s\".", name->s_name); return; }
+
+  if (!mess_share(x->i_list_2, src, x)) {
+    WARN(x->warnings, "share:  The list published as \"%s\" could not be shared.", name->s_name);
+    return;
   }
+  lchange_pack(x);
 }
 
 /****************************************************************
@@ -292,7 +470,11 @@ void lchange_clear(t_lchange *x)
 {
   TRACE("lchange_clear");
 
+  ASSERT_ALLOC;
+
   mess_set_empty(x->i_list_2);
+  lchange_pack(x);
+  x->h_cnt = 0;
 }
 
 /****************************************************************
@@ -302,61 +484,349 @@ void lchange_post(t_lchange *x)
 {
   TRACE("lchange_post");
 
-  POST("Max length: %i - Warnings: %i - Lock: %i",
-    x->maxlen, x->warnings, x->is_locked);
+  POST("Max length: %i - Warnings: %i - Lock: %i - Tolerance: %f + %f * value",
+    x->maxlen, x->warnings, x->is_locked, x->tol_abs, x->tol_rel);
+  POST("History: %i / %i", x->h_cnt, x->history);
   mess_post(x->i_list_2, "Stored list", x);
 }
 
+/****************************************************************
+*  Get the list to store the input of the right inlet in
+*
+*  The list of the inbox with the inbox attribute.
+*/
+t_mess lchange_target(t_lchange *x)
+{
+  TRACE("lchange_target");
+
+  return x->inbox ? inbox_write_begin(x->inbox_2) : x->i_list_2;
+}
+
+/****************************************************************
+*  Helper function called after the input of the right inlet has been stored
+*
+*  With the inbox attribute, the list is only posted,
+*  to be applied at the next input in the left inlet.
+*/
+void lchange_stored(t_lchange *x)
+{
+  TRACE("lchange_stored");
+
+  if (x->inbox) { inbox_write_end(x->inbox_2); }
+  else { lchange_pack(x); }
+}
+
+/****************************************************************
+*  Pack the stored list in compact words, if all its atoms can be stored
+*
+*  To be called whenever the stored list is modified.
+*/
+void lchange_pack(t_lchange *x)
+{
+  TRACE("lchange_pack");
+
+  x->is_packed = compact_pack(x->i_packed, x->i_list_2);
+}
+
+/****************************************************************
+*  Helper function to test if two numbers are different
+*
+*  Non-finite numbers are compared exactly, whatever the tolerances:
+*  an infinity only matches itself, and NaN is always a change.
+*/
+__inline t_bool nums_diff(t_lchange *x, double f1, double f2)
+{
+  if ((x->tol_abs == 0) && (x->tol_rel == 0)) { return f1 != f2; }
+  if (!isfinite(f1) || !isfinite(f2)) { return !(f1 == f2); }
+  return fabs(f1 - f2) > x->tol_abs + x->tol_rel * MAX(fabs(f1), fabs(f2));
+}
+
 /****************************************************************
 *  Helper function to test if two atoms are different
 */
-__inline t_bool atoms_diff(t_atom *atom1, t_atom *atom2)
+__inline t_bool atoms_diff(t_lchange *x, t_atom *atom1, t_atom *atom2)
 {
   return !(((atom_gettype(atom1) == A_SYM) && (atom_gettype(atom2) == A_SYM)
       && (atom_getsym(atom1) == atom_getsym(atom2)))
     || (((atom_gettype(atom1) == A_LONG) || (atom_gettype(atom1) == A_FLOAT))   // or both are numbers
       && ((atom_gettype(atom2) == A_LONG) || (atom_gettype(atom2) == A_FLOAT))
-      && (atom_getfloat(atom1) == atom_getfloat(atom2))));                      // and equal
+      && !nums_diff(x, atom_getfloat(atom1), atom_getfloat(atom2))));           // and equal
+}
+
+/****************************************************************
+*  Helper function to test if a compact word and an atom are different
+*
+*  Same as atoms_diff(), the word being an int, a float or a symbol.
+*/
+__inline t_bool word_diff(t_lchange *x, t_mess_word word, t_atom *atom)
+{
+  long type = atom_gettype(atom);
+
+  if (word_gettype(word) == A_SYM) { return !((type == A_SYM) && (word_getsym(word) == atom_getsym(atom))); }
+  return !(((type == A_LONG) || (type == A_FLOAT)) && !nums_diff(x, word_getfloat(word), atom_getfloat(atom)));
+}
+
+/****************************************************************
+*  Helper function to test if a list matches a message structure
+*
+*  The compact words are used if words is not NULL.
+*/
+t_bool lchange_match(t_lchange *x, t_mess mess, t_mess_word *words, t_symbol *sym, long argc, t_atom *argv, char offset)
+{
+  t_bool match = true;
+
+  // Proceed through a series of matching tests
+  if ((argc + offset != mess->len_cur)              // matching lengths
+    || ((sym != mess->sym)                          // matching leading symbols
+      && (sym != sym_int) && (sym != sym_float)))   // special case for int and float with same value
+    { match = false; }
+
+  // Packed list:  compare to the compact words and stop at the first difference
+  else if (words) {
+    for (t_mess_int i = 0; i < mess->len_cur - offset; i++) {
+      if (word_diff(x, words[offset + i], argv + i)) { match = false; break; } }
+  }
+
+  // Test the remaining elements of the list, and stop at the first difference
+  else {
+    for (t_mess_int i = 0; i < mess->len_cur - offset; i++) {
+      if (atoms_diff(x, argv + i, mess->list + offset + i)) { match = false; break; } }
+  }
+
+  return match;
+}
+
+/****************************************************************
+*  Helper function to test if a list matches the stored list,
+*  and to set the changed positions in the same pass
+*
+*  Positions beyond the length of the stored list are changed.
+*  The bitmask is packed in ints of 32 bits, from the lowest bit.
+*  They are output as signed 32 bit values on all builds:  bit 31 is the sign.
+*/
+t_bool lchange_match_changes(t_lchange *x, t_symbol *sym, long argc, t_atom *argv, char offset)
+{
+  TRACE("lchange_match_changes");
+
+  t_mess stored = x->i_list_2;
+  t_atom *list = stored->list + stored->offset;
+  t_mess_word *words = x->is_packed ? x->i_packed->words + stored->offset : NULL;
+
+  t_mess_int len = stored->len_cur - stored->offset;   // number of stored atoms to compare
+  t_mess_int cnt = MIN((t_mess_int)argc, x->maxlen);   // number of positions to test
+  t_mess_int changed = 0;
+  t_atom *out = x->o_changes->list;
+  t_uint32 bits = 0;
+  t_bool diff;
+
+  for (t_mess_int i = 0; i < cnt; i++) {
+
+    if (i >= len) { diff = true; }
+    else if (words) { diff = word_diff(x, words[i], argv + i); }
+    else { diff = atoms_diff(x, argv + i, list + i); }
+
+    changed += diff ? 1 : 0;
+
+    // Indexes
+    if (x->changes == 1) {
+      if (diff) { atom_setlong(out++, i); }
+    }
+    // ... or bitmask
+    else {
+      bits |= (t_uint32)(diff ? 1 : 0) << (i & 31);
+      if (((i & 31) == 31) || (i == cnt - 1)) { atom_setlong(out++, (t_atom_long)(t_int32)bits); bits = 0; }
+    }
+  }
+
+  x->o_changes->len_cur = (t_mess_int)(out - x->o_changes->list);
+  mess_set_type(x->o_changes);
+
+  return (argc + offset == stored->len_cur)          // matching lengths
+    && ((sym == stored->sym)                         // matching leading symbols
+      || (sym == sym_int) || (sym == sym_float))     // special case for int and float with same value
+    && (changed == 0);                               // matching atoms
+}
+
+/****************************************************************
+*  Helper function to hash a list
+*
+*  Ints and floats with the same value have the same hash,
+*  and int, float and list messages are hashed alike.
+*/
+t_uint32 lchange_hash(t_symbol *sym, long argc, t_atom *argv, char offset)
+{
+  t_uint64 hash = 14695981039346656037ULL;    // FNV-1a, on 64 bit words
+  t_uint64 word;
+  double f;
+
+  word = offset ? (t_uint64)(size_t)sym : 0;
+  hash = (hash ^ word) * 1099511628211ULL;
+
+  for (long i = 0; i < argc; i++) {
+    switch (atom_gettype(argv + i)) {
+    case A_LONG:
+    case A_FLOAT:
+      f = atom_getfloat(argv + i);
+      if (f == 0) { f = 0; }    // same hash for -0 and 0
+      memcpy(&word, &f, sizeof(word));
+      break;
+    default:
+      word = (t_uint64)(size_t)atom_getsym(argv + i);
+      break;
+    }
+    hash = (hash ^ word) * 1099511628211ULL;
+  }
+
+  return (t_uint32)(hash ^ (hash >> 32));
+}
+
+/****************************************************************
+*  Look for a list in the history
+*
+*  The hashes are compared first, unless a tolerance is used.
+*  Returns the index of the matching list, or -1 if none.
+*/
+t_int32 lchange_history_find(t_lchange *x, t_uint32 hash, t_symbol *sym, long argc, t_atom *argv, char offset)
+{
+  TRACE("lchange_history_find");
+
+  t_bool use_hash = (x->tol_abs == 0) && (x->tol_rel == 0);
+
+  for (t_int32 k = 0; k < x->h_cnt; k++) {
+    if ((!use_hash || (x->h_hashes[k] == hash))
+      && lchange_match(x, x->h_lists + k, NULL, sym, argc, argv, offset)) {
+      x->h_stamps[k] = ++x->h_clock;
+      return k;
+    }
+  }
+
+  return -1;
+}
+
+/****************************************************************
+*  Add a list to the history
+*
+*  The least recently used list is replaced if the history is full.
+*/
+void lchange_history_add(t_lchange *x, t_uint32 hash, t_symbol *sym, long argc, t_atom *argv, char offset)
+{
+  TRACE("lchange_history_add");
+
+  t_int32 slot = 0;
+
+  if (x->h_cnt < x->history) { slot = x->h_cnt++; }
+  else {
+    for (t_int32 k = 1; k < x->h_cnt; k++) {
+      if (x->h_stamps[k] < x->h_stamps[slot]) { slot = k; } }
+  }
+
+  mess_set(x->h_lists + slot, sym, argc, argv, offset, x, false);
+  x->h_hashes[slot] = hash;
+  x->h_stamps[slot] = ++x->h_clock;
 }
 
 /****************************************************************
-*  Compare the input list to the stored list
+*  Allocate the history
+*
+*  The history is emptied, and freed if history or maxlen is 0.
+*/
+t_max_err lchange_history_alloc(t_lchange *x, t_int32 history, t_mess_int maxlen)
+{
+  TRACE("lchange_history_alloc");
+
+  // Free the current history
+  if (x->h_lists) {
+    for (t_int32 k = 0; k < x->history; k++) { mess_clear(x->h_lists + k); }
+    sysmem_freeptr(x->h_lists);
+  }
+  if (x->h_hashes) { sysmem_freeptr(x->h_hashes); }
+  if (x->h_stamps) { sysmem_freeptr(x->h_stamps); }
+
+  x->h_lists = NULL;
+  x->h_hashes = NULL;
+  x->h_stamps = NULL;
+  x->h_clock = 0;
+  x->h_cnt = 0;
+  x->history = history;
+
+  if (!history || !maxlen) { return MAX_ERR_NONE; }
+
+  // Allocate the new one
+  x->h_lists = (t_mess_struct *)sysmem_newptr(history * sizeof(t_mess_struct));
+  x->h_hashes = (t_uint32 *)sysmem_newptr(history * sizeof(t_uint32));
+  x->h_stamps = (t_uint64 *)sysmem_newptr(history * sizeof(t_uint64));
+
+  if (x->h_lists) {
+    for (t_int32 k = 0; k < history; k++) { mess_init(x->h_lists + k); } }
+
+  t_bool is_null = !x->h_lists || !x->h_hashes || !x->h_stamps;
+  for (t_int32 k = 0; !is_null && (k < history); k++) {
+    mess_realloc(x->h_lists + k, maxlen, x);
+    is_null = MESS_IS_NULL(x->h_lists + k);
+  }
+
+  // Test the allocation
+  if (is_null) {
+    ERR("history:  Allocation error.");
+    lchange_history_alloc(x, 0, 0);
+    return MAX_ERR_OUT_OF_MEM;
+  }
+
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Compare the input list to the stored list and the history
 */
 void lchange_action(t_lchange *x, t_symbol *sym, long argc, t_atom *argv, char offset)
 {
   TRACE("lchange_action");
 
+  // Apply the newest list posted to the inbox
+  if (x->inbox && inbox_take(x->inbox_2, x->i_list_2)) { lchange_pack(x); }
+
   if (argc + offset > x->maxlen) {
     WARN(x->warnings, "The input message is clipped from length %i to %i.",
       argc + offset, x->maxlen);
   }
 
-  t_bool match = true;
+  t_uint32 hash = 0;
+  t_int32 slot = -1;
+  t_bool match;
 
-  // Proceed through a series of matching tests
-  if ((argc + offset != x->i_list_2->len_cur)       // matching lengths
-    || ((sym != x->i_list_2->sym)                   // matching leading symbols
-      && (sym != sym_int) && (sym != sym_float)))   // special case for int and float with same value
-    { match = false; }
+  // Compare to the stored list, in a full pass if the changed positions are needed
+  if (x->changes) { match = lchange_match_changes(x, sym, argc, argv, offset); }
+  else { match = lchange_match(x, x->i_list_2, x->is_packed ? x->i_packed->words : NULL, sym, argc, argv, offset); }
 
-  // Test the remaining elements of the list
-  else {
-    for (t_mess_int i = 0; i < x->i_list_2->len_cur - offset; i++) {
-      if (atoms_diff(argv + i, x->i_list_2->list + offset + i)) { match = false; break; } }
+  // If the matching failed, look for the list in the history
+  if (!match && x->history) {
+    hash = lchange_hash(sym, argc, argv, offset);
+    slot = lchange_history_find(x, hash, sym, argc, argv, offset);
+    match = (slot != -1);
   }
 
   // If the matching failed
   if (match == false) {
     
     // If the stored list is not locked, replace it with the input list
-    if (!x->is_locked) { mess_set(x->i_list_2, sym, argc, argv, offset, x, x->warnings); }
+    if (!x->is_locked) {
+      mess_set(x->i_list_2, sym, argc, argv, offset, x, x->warnings);
+      lchange_pack(x);
+    }
+
+    // Add the list to the history
+    if (x->history) { lchange_history_add(x, hash, sym, argc, argv, offset); }
+
+    // Send the changed positions out of the right outlet
+    if (x->changes) { mess_outlet(x->o_changes, x->outl_changes); }
 
     // Send the list out of the left inlet
     outlet_anything(x->outl_list_diff, sym, (short)argc, argv);
   }
 
-  // Send the list out of the right inlet
+  // Send the list out of the right inlet, after the index if found in the history
   else {
+    if ((slot != -1) && x->hit_index) { outlet_int(x->outl_index, slot); }
     outlet_anything(x->outl_list_same, sym, (short)argc, argv);
   }
 }
@@ -389,17 +859,105 @@ t_max_err lchange_maxlen_set(t_lchange *x, void *attr, long argc, t_atom *argv)
   }
   if (maxlen == x->maxlen) { return MAX_ERR_NONE; }
 
+  // Free the lists, they are allocated on first use, and published again then
+  mess_unpublish(x->i_list_2);
+  mess_clear(x->i_list_2);
+  inbox_clear(x->inbox_2);
+  mess_clear(x->o_changes);
+  compact_clear(x->i_packed);
+  x->is_packed = false;
+  lchange_history_alloc(x, x->history, 0);
+
+  x->maxlen = maxlen;
+  x->alloc_pending = true;
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Allocate the lists and the history
+*
+*  Called on first use through ASSERT_ALLOC.
+*/
+t_max_err lchange_alloc(t_lchange *x)
+{
+  TRACE("lchange_alloc");
+
+  t_mess_int maxlen = x->maxlen;
+  x->alloc_pending = false;
+
   // Realloc the lists
   mess_realloc(x->i_list_2, maxlen, x);
+  mess_realloc(x->o_changes, maxlen, x);
+  t_bool inbox_null = x->inbox ? !inbox_realloc(x->inbox_2, maxlen, x) : false;
+  if (!x->inbox) { inbox_clear(x->inbox_2); }
+  compact_realloc(x->i_packed, maxlen, x);
+  lchange_pack(x);
+  lchange_history_alloc(x, x->history, maxlen);
 
   // Test the allocation
-  if (MESS_IS_NULL(x->i_list_2)) {
+  if (MESS_IS_NULL(x->i_list_2) || MESS_IS_NULL(x->o_changes) || !x->i_packed->words || inbox_null) {
+    mess_unpublish(x->i_list_2);
     mess_clear(x->i_list_2);
+    inbox_clear(x->inbox_2);
+    mess_clear(x->o_changes);
+    compact_clear(x->i_packed);
+    x->is_packed = false;
+    lchange_history_alloc(x, x->history, 0);
     x->maxlen = 0;
     return MAX_ERR_OUT_OF_MEM;
   }
-  else {
-    x->maxlen = maxlen;
-    return MAX_ERR_NONE;
+
+  if (x->i_pub) { mess_publish(x->i_list_2, x->i_pub); }
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Setter function for the history attribute
+*/
+t_max_err lchange_history_set(t_lchange *x, void *attr, long argc, t_atom *argv)
+{
+  TRACE("lchange_history_set");
+
+  // If no arguments, do nothing
+  if (!argc || !argv) { return MAX_ERR_GENERIC; }
+
+  // Get the number of lists and test the value
+  t_int32 history = (t_int32)atom_getlong(argv);
+  if ((history < 0) || (history > HISTORY_MAX)) {
+    WARN(x->warnings, "history:  Invalid value: %i - Expected: int in [0, %i] - Clipped", history, HISTORY_MAX);
+    history = CLAMP(history, 0, HISTORY_MAX);
   }
+  if (history == x->history) { return MAX_ERR_NONE; }
+
+  // Realloc the history, or only set its size before allocation
+  return lchange_history_alloc(x, history, x->alloc_pending ? 0 : x->maxlen);
+}
+
+/****************************************************************
+*  Setter function for the inbox attribute
+*
+*  Once the lists are allocated, only the inbox is allocated or freed,
+*  the newest list posted to it being applied first.
+*/
+t_max_err lchange_inbox_set(t_lchange *x, void *attr, long argc, t_atom *argv)
+{
+  TRACE("lchange_inbox_set");
+
+  // If no arguments, do nothing
+  if (!argc || !argv) { return MAX_ERR_GENERIC; }
+
+  char inbox = atom_getlong(argv) ? 1 : 0;
+  if (inbox == x->inbox) { return MAX_ERR_NONE; }
+
+  if (x->maxlen && !x->alloc_pending) {
+    if (inbox) {
+      if (!inbox_realloc(x->inbox_2, x->maxlen, x)) { return MAX_ERR_OUT_OF_MEM; } }
+    else {
+      if (inbox_take(x->inbox_2, x->i_list_2)) { lchange_pack(x); }
+      inbox_clear(x->inbox_2);
+    }
+  }
+
+  x->inbox = inbox;
+  return MAX_ERR_NONE;
 }
@@ -0,0 +1,35 @@
+/**
+*  @file
+*  Lclip - a Max object to clip a list between a minimum and a maximum list
+*
+*  The element-wise engine is in Lelem.c, the operator is defined below.
+*
+*  Notes:
+*    The second inlet sets the minimum and the third inlet the maximum.
+*    Additional inlets alternate between minimum and maximum.
+*/
+
+/****************************************************************
+*  Header files
+*/
+#include "ext.h"
+#include "ext_obex.h"
+#include "Lobjects.h"
+#include "Lelem.h"
+
+/****************************************************************
+*  Operator definition
+*/
+#define LELEM_OP_LONG(a, b, k)   (((k) & 1) ? MAX((a), (b)) : MIN((a), (b)))
+#define LELEM_OP_FLOAT(a, b, k)  (((k) & 1) ? MAX((a), (b)) : MIN((a), (b)))
+#define LELEM_INT_OUTPUT         1
+
+#include "Lelem_kernel.h"
+
+/****************************************************************
+*  Initialization
+*/
+void ext_main(void *r)
+{
+  lelem_class_new("Lclip", "clipped list (list)", 3);
+}
@@ -0,0 +1,35 @@
+/**
+*  @file
+*  Ldiv - a Max object to divide the left list by the other lists
+*
+*  The element-wise engine is in Lelem.c, the operator is defined below.
+*
+*  Notes:
+*    The output is always a float.
+*    Division by zero gives 0.
+*/
+
+/****************************************************************
+*  Header files
+*/
+#include "ext.h"
+#include "ext_obex.h"
+#include "Lobjects.h"
+#include "Lelem.h"
+
+/****************************************************************
+*  Operator definition
+*/
+#define LELEM_OP_LONG(a, b, k)   0
+#define LELEM_OP_FLOAT(a, b, k)  (((b) == 0.) ? 0. : (a) / (b))
+#define LELEM_INT_OUTPUT         0
+
+#include "Lelem_kernel.h"
+
+/****************************************************************
+*  Initialization
+*/
+void ext_main(void *r)
+{
+  lelem_class_new("Ldiv", "quotient of the input lists (list)", 2);
+}
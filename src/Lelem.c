@@ -0,0 +1,1224 @@
+/**
+*  @file
+*  Lelem - the shared engine of the element-wise list operators
+*
+*  Factored out of Lmax and Lmin.
+*
+*  The engine handles the inlets, the stored lists, the broadcast of
+*  single element lists, zero padding, frames and attributes.
+*  With the inbox attribute, the lists of the cold inlets can be sent from
+*  another thread, and the newest ones are applied at the next hot input.
+*  With the async attribute, long lists are processed by a worker thread,
+*  and the output is delivered on the main thread. Cold inputs recompute in
+*  the worker without output, and bang outputs the latest delivered result.
+*  With the budget attribute, long lists are processed over several scheduler
+*  ticks, within a time budget per tick, and output once complete.
+*  With the precision attribute set to 32, numeric lists are packed as 32 bit
+*  floats when they are input, and processed as such into a list of floats.
+*  The packed lists are kept in addition to the lists of atoms, for speed and not memory.
+*  The operator itself is defined by each external with Lelem_kernel.h.
+*/
+
+/****************************************************************
+*  Header files
+*/
+#include "Lelem.h"
+
+/****************************************************************
+*  Allocation function called by ASSERT_ALLOC
+*/
+#define ALLOC_FUNCTION lelem_alloc
+
+/****************************************************************
+*  Global class pointer and class specific values
+*/
+static t_class    *lelem_class      = NULL;
+static const char *lelem_name       = NULL;
+static const char *lelem_assist_out = NULL;
+static t_int32     lelem_inlets_def = 2;
+
+/****************************************************************
+*  Create and register the class of an element-wise external
+*
+*  To be called from ext_main().
+*/
+void lelem_class_new(const char *name, const char *assist_out, t_int32 inlets_def)
+{
+  // Store the class specific values
+  lelem_name       = name;
+  lelem_assist_out = assist_out;
+  lelem_inlets_def = inlets_def;
+
+  // Initialize frequently used symbols
+  sym_init();
+
+  t_class *c;
+
+  c = class_new(name,
+    (method)lelem_new,
+    (method)lelem_free,
+    (long)sizeof(t_lelem),
+    NULL, A_GIMME, 0);
+
+  class_addmethod(c, (method)lelem_assist,   "assist",    A_CANT,  0);
+  class_addmethod(c, (method)lelem_bang,     "bang",               0);
+  class_addmethod(c, (method)lelem_int,      "int",       A_LONG,  0);
+  class_addmethod(c, (method)lelem_float,    "float",     A_FLOAT, 0);
+  class_addmethod(c, (method)lelem_list,     "list",      A_GIMME, 0);
+  class_addmethod(c, (method)lelem_anything, "anything",  A_GIMME, 0);
+  class_addmethod(c, (method)lelem_frames,   "frames",    A_GIMME, 0);
+  class_addmethod(c, (method)stdinletinfo,   "inletinfo", A_CANT,  0);
+  class_addmethod(c, (method)lelem_clear,    "clear",              0);
+  class_addmethod(c, (method)lelem_post,     "post",               0);
+
+  // Define the class attributes
+  CLASS_ATTR_INT32    (c, "maxlen", 0, t_lelem, maxlen);
+  CLASS_ATTR_ORDER    (c, "maxlen", 0, "1");                    // order
+  CLASS_ATTR_LABEL    (c, "maxlen", 0, "maximum list length");  // label
+  CLASS_ATTR_SAVE     (c, "maxlen", 0);                         // save with patcher
+  CLASS_ATTR_SELFSAVE (c, "maxlen", 0);                         // display as saved
+  CLASS_ATTR_ACCESSORS(c, "maxlen", NULL, lelem_maxlen_set);
+
+  CLASS_ATTR_CHAR     (c, "warnings", 0, t_lelem, warnings);
+  CLASS_ATTR_ORDER    (c, "warnings", 0, "2");
+  CLASS_ATTR_STYLE    (c, "warnings", 0, "onoff");
+  CLASS_ATTR_LABEL    (c, "warnings", 0, "report warnings");
+  CLASS_ATTR_FILTER_CLIP(c, "warnings", 0, 1);
+  CLASS_ATTR_SAVE     (c, "warnings", 0);
+  CLASS_ATTR_SELFSAVE (c, "warnings", 0);
+
+  CLASS_ATTR_INT32    (c, "inlets", 0, t_lelem, inlets);
+  CLASS_ATTR_ORDER    (c, "inlets", 0, "3");
+  CLASS_ATTR_LABEL    (c, "inlets", 0, "number of inlets");
+  CLASS_ATTR_SAVE     (c, "inlets", 0);
+  CLASS_ATTR_SELFSAVE (c, "inlets", 0);
+  CLASS_ATTR_ACCESSORS(c, "inlets", NULL, lelem_inlets_set);
+
+  CLASS_ATTR_CHAR     (c, "largepages", 0, t_lelem, largepages);
+  CLASS_ATTR_ORDER    (c, "largepages", 0, "4");
+  CLASS_ATTR_STYLE    (c, "largepages", 0, "onoff");
+  CLASS_ATTR_LABEL    (c, "largepages", 0, "large pages for large lists");
+  CLASS_ATTR_SAVE     (c, "largepages", 0);
+  CLASS_ATTR_SELFSAVE (c, "largepages", 0);
+  CLASS_ATTR_ACCESSORS(c, "largepages", NULL, lelem_largepages_set);
+
+  CLASS_ATTR_CHAR     (c, "inbox", 0, t_lelem, inbox);
+  CLASS_ATTR_ORDER    (c, "inbox", 0, "5");
+  CLASS_ATTR_STYLE    (c, "inbox", 0, "onoff");
+  CLASS_ATTR_LABEL    (c, "inbox", 0, "apply cold inputs at next hot input");
+  CLASS_ATTR_SAVE     (c, "inbox", 0);
+  CLASS_ATTR_SELFSAVE (c, "inbox", 0);
+  CLASS_ATTR_ACCESSORS(c, "inbox", NULL, lelem_inbox_set);
+
+  CLASS_ATTR_INT32    (c, "async", 0, t_lelem, async);
+  CLASS_ATTR_ORDER    (c, "async", 0, "6");
+  CLASS_ATTR_LABEL    (c, "async", 0, "minimum length processed asynchronously");
+  CLASS_ATTR_SAVE     (c, "async", 0);
+  CLASS_ATTR_SELFSAVE (c, "async", 0);
+  CLASS_ATTR_ACCESSORS(c, "async", NULL, lelem_async_set);
+
+  CLASS_ATTR_CHAR     (c, "drop", 0, t_lelem, drop);
+  CLASS_ATTR_ORDER    (c, "drop", 0, "7");
+  CLASS_ATTR_ENUMINDEX(c, "drop", 0, "older newer");
+  CLASS_ATTR_LABEL    (c, "drop", 0, "requests dropped when busy");
+  CLASS_ATTR_FILTER_CLIP(c, "drop", 0, 1);
+  CLASS_ATTR_SAVE     (c, "drop", 0);
+  CLASS_ATTR_SELFSAVE (c, "drop", 0);
+
+  CLASS_ATTR_INT32    (c, "budget", 0, t_lelem, budget);
+  CLASS_ATTR_ORDER    (c, "budget", 0, "8");
+  CLASS_ATTR_LABEL    (c, "budget", 0, "time budget per tick (microseconds)");
+  CLASS_ATTR_FILTER_MIN(c, "budget", 0);
+  CLASS_ATTR_SAVE     (c, "budget", 0);
+  CLASS_ATTR_SELFSAVE (c, "budget", 0);
+
+  CLASS_ATTR_INT32    (c, "precision", 0, t_lelem, precision);
+  CLASS_ATTR_ORDER    (c, "precision", 0, "9");
+  CLASS_ATTR_LABEL    (c, "precision", 0, "precision of numeric lists (32 or 64 bits)");
+  CLASS_ATTR_SAVE     (c, "precision", 0);
+  CLASS_ATTR_SELFSAVE (c, "precision", 0);
+  CLASS_ATTR_ACCESSORS(c, "precision", NULL, lelem_precision_set);
+
+  // Register the class
+  class_register(CLASS_BOX, c);
+  lelem_class = c;
+}
+
+/****************************************************************
+*  Constructor
+*/
+void *lelem_new(t_symbol *sym, long argc, t_atom *argv)
+{
+  t_lelem *x = NULL;
+
+  // Allocate the object and test
+  x = (t_lelem *)object_alloc(lelem_class);
+  if (!x) { error("%s:  Object allocation failed.", lelem_name); return NULL; }
+
+  TRACE("lelem_new");
+
+  // Initialize the attributes
+  x->warnings = 1;
+  x->maxlen   = 0;
+  x->inlets   = lelem_inlets_def;
+  x->largepages = 0;
+  x->inbox    = 0;
+  x->async    = 0;
+  x->drop     = WORKER_DROP_OLDER;
+  x->budget   = 0;
+  x->precision = 64;
+
+  // Initialize the proxies and message structures
+  x->outl_list = NULL;    // also used to test if the object was already created
+  for (t_int32 k = 0; k < INLETS_MAX; k++) {
+    x->inl_proxies[k] = NULL;
+    mess_init(x->i_lists + k);
+    inbox_init(x->inboxes + k);
+    mess_init(x->a_next + k);
+    mess_init(x->a_work + k);
+    x->a_p_lists[k] = NULL;
+    x->p_lists[k] = NULL;
+    x->p_len[k] = 0;
+    x->p_valid[k] = false;
+  }
+  x->p_out = NULL;
+  x->a_p_out = NULL;
+  mess_init(x->o_list);
+  mess_init(x->o_frames);
+  mess_init(x->a_out);
+  mess_init(x->a_done);
+  mess_init(x->a_deliv);
+  x->a_next_req.stamp = x->a_work_req.stamp = x->a_done_req.stamp = 0;
+  x->a_next_req.output = x->a_work_req.output = x->a_done_req.output = false;
+  x->a_deliv_stamp = 0;
+  x->o_stamp = 0;
+  x->stamps = 0;
+  worker_init(x->worker);
+  slicer_init(x->slicer);
+  x->s_output = false;
+  x->s_packed = false;
+  x->alloc_pending = false;
+
+  // Process the attribute arguments
+  attr_args_process(x, (short)argc, argv);
+
+  // Allocate the lists if the allocation was not triggered by arguments
+  if (x->maxlen == 0) {
+    t_atom atom[1];
+    atom_setlong(atom, MAXLEN_DEF);
+    lelem_maxlen_set(x, NULL, 1, atom); }
+
+  // Set inlets, outlets and proxies, once the number of inlets is known
+  x->inl_proxy_ind = 0;
+  for (t_int32 k = x->inlets - 1; k > 0; k--) {
+    x->inl_proxies[k] = proxy_new((t_object *)x, k, &x->inl_proxy_ind); }
+  x->outl_list = outlet_new((t_object *)x, NULL);
+
+  // Process the non attribute arguments to set the second input list if necessary
+  argc = (t_mess_int)attr_args_offset((short)argc, argv);
+  if (argc && (!x->alloc_pending || (lelem_alloc(x) == MAX_ERR_NONE))) {
+    mess_set_list(x->i_lists + 1, argc, argv, x, x->warnings);
+    mess_set_type(x->i_lists + 1);    // determine the proper symbol (int, float, list, message)
+    mess_zpad(x->i_lists + 1);
+    lelem_pack(x, 1);
+  }
+
+  return x;
+}
+
+/****************************************************************
+*  Destructor
+*/
+void lelem_free(t_lelem *x)
+{
+  TRACE("lelem_free");
+
+  // Free the proxies
+  for (t_int32 k = 1; k < INLETS_MAX; k++) {
+    if (x->inl_proxies[k]) { freeobject((t_object *)x->inl_proxies[k]); } }
+
+  // Stop the worker and the slicer, and free the message structures
+  worker_stop(x->worker);
+  slicer_free(x->slicer);
+  lelem_free_lists(x);
+}
+
+/****************************************************************
+*  Assist
+*/
+void lelem_assist(t_lelem *x, void *b, long msg, long arg, char *dst)
+{
+  switch (msg) {
+  case ASSIST_INLET:
+    switch (arg) {
+    case 0: sprintf(dst, "left input list (int, float, symbol, list)"); break;
+    default: sprintf(dst, "right input list %i (int, float, symbol, list)", (int)arg); break;
+    }
+    break;
+  case ASSIST_OUTLET:
+    switch (arg) {
+    case 0: sprintf(dst, "%s", lelem_assist_out); break;
+    default: break;
+    }
+    break;
+  }
+}
+
+/****************************************************************
+*  Interface functions
+*/
+void lelem_bang(t_lelem *x)
+{
+  TRACE("lelem_bang");
+
+  // Output once complete if the list is being processed
+  if (x->slicer->active) { x->s_output = true; return; }
+
+  // ... or the output delivered by the worker, if more recent
+  if (x->async && STAMP_NEWER(x->a_deliv_stamp, x->o_stamp)) { mess_outlet(x->a_deliv, x->outl_list); return; }
+
+  mess_outlet(x->o_list, x->outl_list);
+}
+
+/****************************************************************
+*  Process int inputs
+*/
+void lelem_int(t_lelem *x, t_atom_long n)
+{
+  TRACE("lelem_int");
+
+  ASSERT_ALLOC;
+
+  t_atom atom[1];
+  atom_setlong(atom, n);
+
+  t_mess_int inlet = (t_mess_int)proxy_getinlet((t_object *)x);
+  mess_set_int(lelem_target(x, inlet), atom, x, x->warnings);
+  lelem_input(x, inlet);
+}
+
+/****************************************************************
+*  Process float inputs
+*/
+void lelem_float(t_lelem *x, double f)
+{
+  TRACE("lelem_float");
+
+  ASSERT_ALLOC;
+
+  t_atom atom[1];
+  atom_setfloat(atom, f);
+
+  t_mess_int inlet = (t_mess_int)proxy_getinlet((t_object *)x);
+  mess_set_float(lelem_target(x, inlet), atom, x, x->warnings);
+  lelem_input(x, inlet);
+}
+
+/****************************************************************
+*  Process list inputs
+*/
+void lelem_list(t_lelem *x, t_symbol *sym, long argc, t_atom *argv)
+{
+  TRACE("lelem_list");
+
+  ASSERT_ALLOC;
+
+  t_mess_int inlet = (t_mess_int)proxy_getinlet((t_object *)x);
+  mess_set_list(lelem_target(x, inlet), argc, argv, x, x->warnings);
+  lelem_input(x, inlet);
+}
+
+/****************************************************************
+*  Process symbols and non list messages
+*/
+void lelem_anything(t_lelem *x, t_symbol *sym, long argc, t_atom *argv)
+{
+  TRACE("lelem_anything");
+
+  ASSERT_ALLOC;
+
+  t_mess_int inlet = (t_mess_int)proxy_getinlet((t_object *)x);
+  mess_set_any(lelem_target(x, inlet), sym, argc, argv, x, x->warnings);
+  lelem_input(x, inlet);
+}
+
+/****************************************************************
+*  Process batches of frames
+*
+*  The frames are processed in order as if they had been received
+*  separately in the left inlet, and the outputs are concatenated.
+*/
+void lelem_frames(t_lelem *x, t_symbol *sym, long argc, t_atom *argv)
+{
+  TRACE("lelem_frames");
+
+  ASSERT_ALLOC;
+
+  if (proxy_getinlet((t_object *)x) != 0) {
+    ERR("frames:  Batches of frames should go into the left inlet.");
+    return;
+  }
+
+  t_mess_int stride;
+  t_mess_int frames = frames_parse(&argc, &argv, &stride, x, x->warnings);
+  if (!frames) { return; }
+
+  lelem_inbox_take(x);
+
+  // Output length of each frame, as given by lelem_out_len()
+  t_mess_int len = MIN(stride, x->maxlen);
+  if (stride == 1) {
+    len = 0;
+    for (t_int32 k = 1; k < x->inlets; k++) { len = MAX(len, x->i_lists[k].len_cur); } }
+  if (!frames_reserve(x->o_frames, frames, len, x->largepages ? MESS_ALLOC_LARGE : MESS_ALLOC_DEFAULT,
+    x, x->warnings)) { return; }
+
+  slicer_cancel(x->slicer);
+
+  x->o_frames->len_cur = 0;
+  for (t_mess_int f = 0; f < frames; f++) {
+    mess_set_list(x->i_lists, stride, argv + f * stride, x, x->warnings && !f);   // warn once if truncated
+    lelem_action(x);
+    mess_cat(x->o_frames, x->o_list, x, x->warnings);
+  }
+
+  mess_set_type(x->o_frames);
+  mess_outlet(x->o_frames, x->outl_list);
+}
+
+/****************************************************************
+*  Clear the lists
+*/
+void lelem_clear(t_lelem *x)
+{
+  TRACE("lelem_clear");
+
+  ASSERT_ALLOC;
+
+  slicer_cancel(x->slicer);
+
+  for (t_int32 k = 0; k < x->inlets; k++) {
+    mess_set_empty(x->i_lists + k);
+    if (k) { lelem_pack(x, k); }
+  }
+  mess_set_empty(x->o_list);
+  mess_set_empty(x->o_frames);
+  x->o_stamp = ++x->stamps;
+}
+
+/****************************************************************
+*  Post information on the external
+*/
+void lelem_post(t_lelem *x)
+{
+  TRACE("lelem_post");
+
+  char name[32];
+
+  POST("Max length: %i - Warnings: %i - Inlets: %i", x->maxlen, x->warnings, x->inlets);
+  mess_post(x->i_lists, "Left input list", x);
+  for (t_int32 k = 1; k < x->inlets; k++) {
+    sprintf(name, "Right input list %i", k);
+    mess_post(x->i_lists + k, name, x);
+  }
+  mess_post(x->o_list, "Output list", x);
+  mess_post(x->o_frames, "Output frames", x);
+}
+
+/****************************************************************
+*  Helper function called after an input list has been stored
+*
+*  The left inlet is hot and triggers the output.
+*  The other inlets are cold, and with the inbox attribute their lists
+*  are only posted, to be applied at the next hot input.
+*  Otherwise the output list is computed without output, by the worker
+*  for long lists with the async attribute, keeping the output of a
+*  computation in progress.
+*/
+void lelem_input(t_lelem *x, t_mess_int inlet)
+{
+  TRACE("lelem_input");
+
+  t_bool output;
+
+  switch (inlet) {
+  case 0:
+    lelem_inbox_take(x);
+    if (lelem_async(x, true)) { slicer_cancel(x->slicer); break; }
+    if (x->budget) { lelem_sliced(x, true); break; }
+    lelem_action(x);
+    mess_outlet(x->o_list, x->outl_list);
+    break;
+
+  default:
+    mess_zpad(lelem_target(x, inlet));   // zero pad in case the left list is longer than the right list
+    if (x->inbox) { inbox_write_end(x->inboxes + inlet); break; }
+    lelem_pack(x, inlet);
+    output = x->slicer->active && x->s_output;
+    if (lelem_async(x, output)) { slicer_cancel(x->slicer); }
+    else if (x->budget) { lelem_sliced(x, output); }
+    else { lelem_action(x); }
+    break;
+  }
+}
+
+/****************************************************************
+*  Get the list to store an input in
+*
+*  The list of the inbox with the inbox attribute, for the cold inlets.
+*/
+t_mess lelem_target(t_lelem *x, t_mess_int inlet)
+{
+  TRACE("lelem_target");
+
+  if (x->inbox && inlet) { return inbox_write_begin(x->inboxes + inlet); }
+  return x->i_lists + inlet;
+}
+
+/****************************************************************
+*  Apply the newest lists posted to the inboxes of the cold inlets
+*/
+void lelem_inbox_take(t_lelem *x)
+{
+  TRACE("lelem_inbox_take");
+
+  if (!x->inbox) { return; }
+  for (t_int32 k = 1; k < x->inlets; k++) {
+    if (inbox_take(x->inboxes + k, x->i_lists + k)) { lelem_pack(x, k); } }
+}
+
+/****************************************************************
+*  Get the output length
+*
+*  The output list is the same length as the left input list
+*  unless the left input list was a single element,
+*  in which case it takes the length of the longest other list.
+*/
+t_mess_int lelem_out_len(t_lelem *x, t_mess inputs)
+{
+  TRACE("lelem_out_len");
+
+  if (inputs[0].len_cur != 1) { return inputs[0].len_cur; }
+
+  t_mess_int len = 0;
+  for (t_int32 k = 1; k < x->inlets; k++) {
+    if (inputs[k].len_cur > len) { len = inputs[k].len_cur; } }
+  return len;
+}
+
+/****************************************************************
+*  Set the output length, and the input pointers and increments
+*
+*  Single element lists are broadcast to the length of the output.
+*/
+void lelem_prepare(t_lelem *x, t_lelem_args *args, t_mess inputs, t_mess out)
+{
+  TRACE("lelem_prepare");
+
+  out->len_cur = lelem_out_len(x, inputs);
+  out->len_used = MAX(out->len_used, out->len_cur);
+  args->out = out->list;
+  args->inlets = x->inlets;
+
+  // Single element lists are not incremented
+  for (t_int32 k = 0; k < x->inlets; k++) {
+    args->in[k] = inputs[k].list;
+    args->incr[k] = (inputs[k].len_cur == 1) ? 0 : 1;
+  }
+}
+
+/****************************************************************
+*  Apply the operator to the input lists
+*
+*  All the lists are processed in a single pass over the output list,
+*  split across the threads of the pool for long lists.
+*/
+void lelem_action(t_lelem *x)
+{
+  TRACE("lelem_action");
+
+  x->o_stamp = ++x->stamps;
+  lelem_prepare(x, x->args, x->i_lists, x->o_list);
+
+  // Numeric lists packed as 32 bit floats, with the precision attribute
+  if (lelem_packed(x)) { pool_for((t_pool_fn)lelem_kernel32, x->args, x->o_list->len_cur); }
+  else { pool_for((t_pool_fn)lelem_kernel, x->args, x->o_list->len_cur); }
+
+  // Set the symbol type of the output list
+  mess_set_type(x->o_list);
+}
+
+/****************************************************************
+*  Pack an input list as 32 bit floats, with the precision attribute
+*
+*  Only the current length is packed. The cold lists are read into their zero padding
+*  when the left list is longer, so the packed lists are zero beyond their length:
+*  from the allocation, and by zeroing the tail left by a longer list.
+*  Returns false if the list holds atoms that are not numbers, or is not packed.
+*/
+t_bool lelem_pack(t_lelem *x, t_int32 k)
+{
+  TRACE("lelem_pack");
+
+  t_mess mess = x->i_lists + k;
+  float *vals = x->p_lists[k];
+  t_mess_int len;
+
+  x->p_valid[k] = false;
+  if (!vals || MESS_IS_NULL(mess)) { return false; }
+
+  len = lelem_pack_atoms(vals, mess->list, mess->len_cur);
+  if (len < mess->len_cur) { x->p_len[k] = MAX(x->p_len[k], len); return false; }
+
+  // Zero the tail of a longer list packed before
+  for (t_mess_int i = mess->len_cur; i < x->p_len[k]; i++) { vals[i] = 0; }
+  x->p_len[k] = mess->len_cur;
+
+  x->p_valid[k] = true;
+  return true;
+}
+
+/****************************************************************
+*  Pack atoms as 32 bit floats
+*
+*  Returns the number of atoms packed, which is less than len
+*  if an atom is not a number.
+*/
+t_mess_int lelem_pack_atoms(float *vals, t_atom *atoms, t_mess_int len)
+{
+  long type;
+
+  for (t_mess_int i = 0; i < len; i++) {
+    type = ATOM_TYPE(atoms + i);
+    if ((type != A_LONG) && (type != A_FLOAT)) { return i; }
+    vals[i] = (float)atom_getfloat(atoms + i);
+  }
+  return len;
+}
+
+/****************************************************************
+*  Set the packed lists for the kernel, packing the left list
+*
+*  Returns false if the lists should be processed as atoms.
+*/
+t_bool lelem_packed(t_lelem *x)
+{
+  TRACE("lelem_packed");
+
+  if ((x->precision != 32) || !lelem_pack(x, 0)) { return false; }
+  for (t_int32 k = 1; k < x->inlets; k++) {
+    if (!x->p_valid[k]) { return false; } }
+
+  for (t_int32 k = 0; k < x->inlets; k++) { x->args->in32[k] = x->p_lists[k]; }
+  x->args->out32 = x->p_out;
+  return true;
+}
+
+/****************************************************************
+*  Free a packed list
+*/
+void lelem_pack_free(t_lelem *x, t_int32 k)
+{
+  if (x->p_lists[k]) { sysmem_freeptr(x->p_lists[k]); }
+  x->p_lists[k] = NULL;
+  x->p_len[k] = 0;
+  x->p_valid[k] = false;
+}
+
+/****************************************************************
+*  Process the inputs asynchronously, if the output is long enough
+*
+*  The inputs are copied for the worker, and the output is delivered later,
+*  and sent out if requested. A request replacing older ones takes over their output.
+*  Returns false if the inputs should be processed synchronously.
+*/
+t_bool lelem_async(t_lelem *x, t_bool output)
+{
+  TRACE("lelem_async");
+
+  if (!x->async) { return false; }
+
+  t_mess_int len = lelem_out_len(x, x->i_lists);
+  if (len < x->async) { return false; }
+
+  if (!worker_start(x->worker, x, (method)lelem_async_take, (method)lelem_async_run,
+    (method)lelem_async_give, (method)lelem_async_deliver)) {
+    WARN(x->warnings, "async:  The worker thread could not be started.");
+    return false;
+  }
+
+  worker_lock(x->worker);
+
+  // Copy the inputs, unless the request is dropped
+  if ((x->drop == WORKER_DROP_OLDER) || !worker_busy(x->worker)) {
+    for (t_int32 k = 0; k < x->inlets; k++) {
+      t_mess src = x->i_lists + k;
+      t_mess dest = x->a_next + k;
+      dest->len_cur = src->len_cur;
+      dest->sym = src->sym;
+      dest->offset = src->offset;
+      ATOMS_COPY(dest->list, src->list, MIN(MAX(src->len_cur, len), src->len_max));
+    }
+    x->a_next_req.output = output || x->a_next_req.output || x->a_work_req.output;
+    x->a_next_req.stamp = ++x->stamps;
+    worker_request(x->worker, x->drop);
+  }
+
+  worker_unlock(x->worker);
+  return true;
+}
+
+/****************************************************************
+*  Worker functions:  take the inputs, process them, give the output
+*/
+void lelem_async_take(t_lelem *x)
+{
+  t_mess_struct tmp;
+
+  for (t_int32 k = 0; k < x->inlets; k++) {
+    tmp = x->a_work[k]; x->a_work[k] = x->a_next[k]; x->a_next[k] = tmp; }
+
+  x->a_work_req = x->a_next_req;
+  x->a_next_req.output = false;
+}
+
+void lelem_async_run(t_lelem *x)
+{
+  lelem_prepare(x, x->a_args, x->a_work, x->a_out);
+
+  // Same kernel as synchronously, for the same output types and rounding
+  if (lelem_async_packed(x)) { pool_for((t_pool_fn)lelem_kernel32, x->a_args, x->a_out->len_cur); }
+  else { pool_for((t_pool_fn)lelem_kernel, x->a_args, x->a_out->len_cur); }
+
+  mess_set_type(x->a_out);
+}
+
+/****************************************************************
+*  Set the packed lists for the kernel in the worker, packing its inputs
+*
+*  The inputs are copied with their zero padding up to the output length,
+*  and packed up to it, or only the first element if broadcast.
+*  Returns false if the lists should be processed as atoms.
+*/
+t_bool lelem_async_packed(t_lelem *x)
+{
+  t_lelem_args *args = x->a_args;
+  t_mess_int len;
+
+  if ((x->precision != 32) || !x->a_p_out) { return false; }
+
+  for (t_int32 k = 0; k < x->inlets; k++) {
+    len = args->incr[k] ? x->a_out->len_cur : 1;
+    if (lelem_pack_atoms(x->a_p_lists[k], x->a_work[k].list, len) < len) { return false; }
+    args->in32[k] = x->a_p_lists[k];
+  }
+  args->out32 = x->a_p_out;
+  return true;
+}
+
+void lelem_async_give(t_lelem *x)
+{
+  t_mess_struct tmp;
+
+  tmp = *x->a_done; *x->a_done = *x->a_out; *x->a_out = tmp;
+
+  // An output not delivered yet is taken over
+  x->a_done_req.stamp = x->a_work_req.stamp;
+  x->a_done_req.output = x->a_done_req.output || x->a_work_req.output;
+  x->a_work_req.output = false;
+}
+
+/****************************************************************
+*  Deliver the output of the worker, called by the qelem on the main thread
+*
+*  The output is sent out if requested, unless a more recent output list
+*  was computed synchronously in the meantime.
+*/
+void lelem_async_deliver(t_lelem *x)
+{
+  TRACE("lelem_async_deliver");
+
+  t_mess_struct tmp;
+  t_lelem_req req;
+  t_bool ready;
+
+  worker_lock(x->worker);
+  ready = worker_result(x->worker);
+  if (ready) {
+    tmp = *x->a_deliv; *x->a_deliv = *x->a_done; *x->a_done = tmp;
+    req = x->a_done_req;
+    x->a_done_req.output = false;
+  }
+  worker_unlock(x->worker);
+
+  if (!ready) { return; }
+
+  x->a_deliv_stamp = req.stamp;
+  if (req.output && STAMP_NEWER(req.stamp, x->o_stamp)) { mess_outlet(x->a_deliv, x->outl_list); }
+}
+
+/****************************************************************
+*  Apply the operator over several ticks, within the time budget
+*
+*  Restarts if the lists are modified before the processing is complete.
+*/
+void lelem_sliced(t_lelem *x, t_bool output)
+{
+  TRACE("lelem_sliced");
+
+  if (!slicer_setup(x->slicer, x, (method)lelem_slice_step, (method)lelem_slice_done)) {
+    WARN(x->warnings, "budget:  The clock could not be created.");
+    lelem_action(x);
+    if (output) { mess_outlet(x->o_list, x->outl_list); }
+    return;
+  }
+
+  x->s_output = output;
+  x->o_stamp = ++x->stamps;
+  lelem_prepare(x, x->args, x->i_lists, x->o_list);
+  x->s_packed = lelem_packed(x);
+  slicer_start(x->slicer, x->o_list->len_cur, x->budget);
+}
+
+/****************************************************************
+*  Slicer functions:  process a range, and output once complete
+*/
+void lelem_slice_step(t_lelem *x, t_mess_int beg, t_mess_int end)
+{
+  if (x->s_packed) { lelem_kernel32(x->args, beg, end); }
+  else { lelem_kernel(x->args, beg, end); }
+}
+
+void lelem_slice_done(t_lelem *x)
+{
+  TRACE("lelem_slice_done");
+
+  mess_set_type(x->o_list);
+  if (x->s_output) { mess_outlet(x->o_list, x->outl_list); }
+}
+
+/****************************************************************
+*  Output function
+*/
+__inline void lelem_output(t_lelem *x)
+{
+  TRACE("lelem_output");
+
+  mess_outlet(x->o_list, x->outl_list);
+}
+
+/****************************************************************
+*  Setter function for the maxlen attribute
+*/
+t_max_err lelem_maxlen_set(t_lelem *x, void *attr, long argc, t_atom *argv)
+{
+  TRACE("lelem_maxlen_set");
+
+  // If no arguments, do nothing
+  if (!argc || !argv) { return MAX_ERR_GENERIC; }
+
+  // Get the length and test the value
+  t_mess_int maxlen = (t_mess_int)atom_getlong(argv);
+  if (maxlen <= 0) {
+    WARN(x->warnings, "maxlen:  Invalid value: %i - Expected: int >= 1 - Default used: %i", maxlen, MAXLEN_DEF);
+    maxlen = MAXLEN_DEF;
+  }
+  if (maxlen == x->maxlen) { return MAX_ERR_NONE; }
+
+  // Free the lists, they are allocated on first use
+  worker_stop(x->worker);
+  slicer_cancel(x->slicer);
+  lelem_free_lists(x);
+
+  x->maxlen = maxlen;
+  x->alloc_pending = true;
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Allocate the lists
+*
+*  Called on first use through ASSERT_ALLOC.
+*/
+t_max_err lelem_alloc(t_lelem *x)
+{
+  TRACE("lelem_alloc");
+
+  x->alloc_pending = false;
+  worker_stop(x->worker);
+  slicer_cancel(x->slicer);
+
+  // Realloc the lists
+  char policy = x->largepages ? MESS_ALLOC_LARGE : MESS_ALLOC_DEFAULT;
+  t_bool is_null = false;
+  for (t_int32 k = 0; k < x->inlets; k++) {
+    mess_realloc_policy(x->i_lists + k, x->maxlen, policy, x);
+    is_null = is_null || MESS_IS_NULL(x->i_lists + k);
+  }
+  is_null = is_null || !lelem_alloc_inboxes(x);
+
+  // ... and the lists of the worker, with the async attribute
+  is_null = is_null || !lelem_alloc_async(x);
+
+  mess_realloc_policy(x->o_list, x->maxlen, policy, x);
+  mess_realloc_policy(x->o_frames, x->maxlen, policy, x);
+
+  // ... and the packed lists, with the precision attribute
+  is_null = is_null || !lelem_alloc_packed(x);
+
+  // Test the allocation
+  if (is_null || MESS_IS_NULL(x->o_list) || MESS_IS_NULL(x->o_frames)) {
+    lelem_free_lists(x);
+    x->maxlen = 0;
+    return MAX_ERR_OUT_OF_MEM;
+  }
+
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Allocate the inboxes of the cold inlets with the inbox attribute, or free them
+*
+*  Returns false if the inboxes could not be allocated.
+*/
+t_bool lelem_alloc_inboxes(t_lelem *x)
+{
+  TRACE("lelem_alloc_inboxes");
+
+  for (t_int32 k = 1; k < x->inlets; k++) {
+    if (!x->inbox) { inbox_clear(x->inboxes + k); }
+    else if (!inbox_realloc(x->inboxes + k, x->maxlen, x)) { return false; }
+  }
+  return true;
+}
+
+/****************************************************************
+*  Allocate the lists of the worker with the async attribute, or free them
+*
+*  The worker should not be running.
+*  Returns false if the lists could not be allocated.
+*/
+t_bool lelem_alloc_async(t_lelem *x)
+{
+  TRACE("lelem_alloc_async");
+
+  char policy = x->largepages ? MESS_ALLOC_LARGE : MESS_ALLOC_DEFAULT;
+  t_mess a_lists[2 * INLETS_MAX + 3];
+  t_int32 a_cnt = 0;
+  t_bool is_null = false;
+
+  for (t_int32 k = 0; k < x->inlets; k++) {
+    a_lists[a_cnt++] = x->a_next + k;
+    a_lists[a_cnt++] = x->a_work + k;
+  }
+  a_lists[a_cnt++] = x->a_out;
+  a_lists[a_cnt++] = x->a_done;
+  a_lists[a_cnt++] = x->a_deliv;
+
+  for (t_int32 i = 0; i < a_cnt; i++) {
+    if (x->async) {
+      mess_realloc_policy(a_lists[i], x->maxlen, policy, x);
+      is_null = is_null || MESS_IS_NULL(a_lists[i]);
+    }
+    else { mess_clear(a_lists[i]); }
+  }
+  return lelem_alloc_async_packed(x) && !is_null;
+}
+
+/****************************************************************
+*  Allocate the packed lists of the worker, with the async attribute
+*  and a precision of 32, or free them
+*
+*  The worker should not be running.
+*  Returns false if the lists could not be allocated.
+*/
+t_bool lelem_alloc_async_packed(t_lelem *x)
+{
+  TRACE("lelem_alloc_async_packed");
+
+  t_bool is_null = false;
+
+  lelem_async_pack_free(x);
+  if (!x->async || (x->precision != 32)) { return true; }
+
+  for (t_int32 k = 0; k < x->inlets; k++) {
+    x->a_p_lists[k] = (float *)sysmem_newptr((long)(x->maxlen * sizeof(float)));
+    is_null = is_null || !x->a_p_lists[k];
+  }
+  x->a_p_out = (float *)sysmem_newptr((long)(x->maxlen * sizeof(float)));
+  is_null = is_null || !x->a_p_out;
+
+  // Only used if all are allocated
+  if (is_null) { lelem_async_pack_free(x); }
+  return !is_null;
+}
+
+/****************************************************************
+*  Free the packed lists of the worker
+*/
+void lelem_async_pack_free(t_lelem *x)
+{
+  for (t_int32 k = 0; k < INLETS_MAX; k++) {
+    if (x->a_p_lists[k]) { sysmem_freeptr(x->a_p_lists[k]); }
+    x->a_p_lists[k] = NULL;
+  }
+  if (x->a_p_out) { sysmem_freeptr(x->a_p_out); }
+  x->a_p_out = NULL;
+}
+
+/****************************************************************
+*  Allocate the packed lists with a precision of 32, or free them
+*
+*  The packed lists are zero initialized, and the cold lists packed once allocated.
+*  Returns false if the packed lists could not be allocated.
+*/
+t_bool lelem_alloc_packed(t_lelem *x)
+{
+  TRACE("lelem_alloc_packed");
+
+  for (t_int32 k = 0; k < INLETS_MAX; k++) { lelem_pack_free(x, k); }
+  if (x->p_out) { sysmem_freeptr(x->p_out); x->p_out = NULL; }
+  if (x->precision != 32) { return true; }
+
+  for (t_int32 k = 0; k < x->inlets; k++) {
+    x->p_lists[k] = (float *)sysmem_newptrclear((long)(x->maxlen * sizeof(float)));
+    if (!x->p_lists[k]) { return false; }
+  }
+  x->p_out = (float *)sysmem_newptr((long)(x->maxlen * sizeof(float)));
+  if (!x->p_out) { return false; }
+
+  for (t_int32 k = 1; k < x->inlets; k++) { lelem_pack(x, k); }
+  return true;
+}
+
+/****************************************************************
+*  Move the lists to the allocation policy of the largepages attribute
+*
+*  The contents are kept. The worker is stopped, and the processing
+*  over several ticks restarted, since they point to the lists.
+*/
+void lelem_move_lists(t_lelem *x)
+{
+  TRACE("lelem_move_lists");
+
+  char policy = x->largepages ? MESS_ALLOC_LARGE : MESS_ALLOC_DEFAULT;
+  t_bool sliced = x->slicer->active;
+  t_bool moved = true;
+
+  worker_stop(x->worker);
+  slicer_cancel(x->slicer);
+
+  for (t_int32 k = 0; k < x->inlets; k++) {
+    moved = mess_move_policy(x->i_lists + k, policy, x) && moved;
+    moved = mess_move_policy(x->a_next + k, policy, x) && moved;
+    moved = mess_move_policy(x->a_work + k, policy, x) && moved;
+  }
+  moved = mess_move_policy(x->a_out, policy, x) && moved;
+  moved = mess_move_policy(x->a_done, policy, x) && moved;
+  moved = mess_move_policy(x->a_deliv, policy, x) && moved;
+  moved = mess_move_policy(x->o_list, policy, x) && moved;
+  moved = mess_move_policy(x->o_frames, policy, x) && moved;
+
+  if (!moved) { WARN(x->warnings, "largepages:  Some lists could not be moved, and keep their allocation."); }
+  if (sliced) { lelem_sliced(x, x->s_output); }
+}
+
+/****************************************************************
+*  Free all the lists
+*/
+void lelem_free_lists(t_lelem *x)
+{
+  TRACE("lelem_free_lists");
+
+  for (t_int32 k = 0; k < INLETS_MAX; k++) {
+    mess_clear(x->i_lists + k);
+    inbox_clear(x->inboxes + k);
+    mess_clear(x->a_next + k);
+    mess_clear(x->a_work + k);
+    lelem_pack_free(x, k);
+  }
+  if (x->p_out) { sysmem_freeptr(x->p_out); x->p_out = NULL; }
+  lelem_async_pack_free(x);
+  mess_clear(x->o_list);
+  mess_clear(x->o_frames);
+  mess_clear(x->a_out);
+  mess_clear(x->a_done);
+  mess_clear(x->a_deliv);
+}
+
+/****************************************************************
+*  Setter function for the inlets attribute
+*
+*  The number of inlets can only be set on creation.
+*/
+t_max_err lelem_inlets_set(t_lelem *x, void *attr, long argc, t_atom *argv)
+{
+  TRACE("lelem_inlets_set");
+
+  // If no arguments, do nothing
+  if (!argc || !argv) { return MAX_ERR_GENERIC; }
+
+  // The proxies are already set after creation
+  if (x->outl_list) {
+    WARN(x->warnings, "inlets:  The number of inlets can only be set on creation.");
+    return MAX_ERR_GENERIC;
+  }
+
+  // Get the number of inlets and test the value
+  t_int32 inlets = (t_int32)atom_getlong(argv);
+  if ((inlets < 2) || (inlets > INLETS_MAX)) {
+    WARN(x->warnings, "inlets:  Invalid value: %i - Expected: int in [2, %i] - Clipped", inlets, INLETS_MAX);
+    inlets = CLAMP(inlets, 2, INLETS_MAX);
+  }
+  if (inlets == x->inlets) { return MAX_ERR_NONE; }
+
+  // Free the lists that are not used anymore
+  for (t_int32 k = inlets; k < x->inlets; k++) {
+    mess_clear(x->i_lists + k);
+    inbox_clear(x->inboxes + k);
+    mess_clear(x->a_next + k);
+    mess_clear(x->a_work + k);
+    lelem_pack_free(x, k);
+  }
+
+  // The additional lists are allocated on first use, if maxlen was already set
+  if (x->maxlen) { x->alloc_pending = true; }
+
+  x->inlets = inlets;
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Setter function for the largepages attribute
+*
+*  The lists already allocated are moved, keeping their contents.
+*/
+t_max_err lelem_largepages_set(t_lelem *x, void *attr, long argc, t_atom *argv)
+{
+  TRACE("lelem_largepages_set");
+
+  // If no arguments, do nothing
+  if (!argc || !argv) { return MAX_ERR_GENERIC; }
+
+  char largepages = atom_getlong(argv) ? 1 : 0;
+  if (largepages == x->largepages) { return MAX_ERR_NONE; }
+
+  x->largepages = largepages;
+  if (x->maxlen && !x->alloc_pending) { lelem_move_lists(x); }
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Setter function for the inbox attribute
+*
+*  Once the lists are allocated, only the inboxes are allocated or freed,
+*  the newest lists posted to them being applied first.
+*/
+t_max_err lelem_inbox_set(t_lelem *x, void *attr, long argc, t_atom *argv)
+{
+  TRACE("lelem_inbox_set");
+
+  // If no arguments, do nothing
+  if (!argc || !argv) { return MAX_ERR_GENERIC; }
+
+  char inbox = atom_getlong(argv) ? 1 : 0;
+  if (inbox == x->inbox) { return MAX_ERR_NONE; }
+
+  if (!x->maxlen || x->alloc_pending) { x->inbox = inbox; return MAX_ERR_NONE; }
+
+  // The lists taken from the inboxes restart the processing over several ticks
+  lelem_inbox_take(x);
+  if (x->slicer->active) { lelem_sliced(x, x->s_output); }
+
+  x->inbox = inbox;
+  if (!lelem_alloc_inboxes(x)) {
+    x->inbox = 0;
+    lelem_alloc_inboxes(x);
+    return MAX_ERR_OUT_OF_MEM;
+  }
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Setter function for the async attribute
+*
+*  Once the lists are allocated, only the lists of the worker are allocated
+*  or freed, if asynchronous processing is turned on or off.
+*/
+t_max_err lelem_async_set(t_lelem *x, void *attr, long argc, t_atom *argv)
+{
+  TRACE("lelem_async_set");
+
+  // If no arguments, do nothing
+  if (!argc || !argv) { return MAX_ERR_GENERIC; }
+
+  // Get the length and test the value
+  t_mess_int async = (t_mess_int)atom_getlong(argv);
+  if (async < 0) {
+    WARN(x->warnings, "async:  Invalid value: %i - Expected: int >= 0 - Set to 0", async);
+    async = 0;
+  }
+  if (async == x->async) { return MAX_ERR_NONE; }
+
+  t_bool toggled = ((async == 0) != (x->async == 0));
+  t_mess_struct tmp;
+  x->async = async;
+  if (!toggled || !x->maxlen || x->alloc_pending) { return MAX_ERR_NONE; }
+
+  worker_stop(x->worker);
+
+  // Keep the output delivered by the worker if more recent, before freeing its lists
+  if (!async && STAMP_NEWER(x->a_deliv_stamp, x->o_stamp)) {
+    tmp = *x->o_list; *x->o_list = *x->a_deliv; *x->a_deliv = tmp;
+    x->o_stamp = x->a_deliv_stamp;
+  }
+
+  if (!lelem_alloc_async(x)) {
+    x->async = 0;
+    lelem_alloc_async(x);
+    return MAX_ERR_OUT_OF_MEM;
+  }
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Setter function for the precision attribute
+*
+*  Once the lists are allocated, only the packed lists are allocated or freed.
+*  The worker is stopped, and the processing over several ticks restarted,
+*  since they point to the packed lists.
+*/
+t_max_err lelem_precision_set(t_lelem *x, void *attr, long argc, t_atom *argv)
+{
+  TRACE("lelem_precision_set");
+
+  // If no arguments, do nothing
+  if (!argc || !argv) { return MAX_ERR_GENERIC; }
+
+  // Get the precision and test the value
+  t_int32 precision = (t_int32)atom_getlong(argv);
+  if ((precision != 32) && (precision != 64)) {
+    WARN(x->warnings, "precision:  Invalid value: %i - Expected: 32 or 64 - Set to 64", precision);
+    precision = 64;
+  }
+  if (precision == x->precision) { return MAX_ERR_NONE; }
+
+  x->precision = precision;
+  if (!x->maxlen || x->alloc_pending) { return MAX_ERR_NONE; }
+
+  t_bool sliced = x->slicer->active;
+  t_max_err err = MAX_ERR_NONE;
+
+  worker_stop(x->worker);
+  slicer_cancel(x->slicer);
+
+  if (!lelem_alloc_packed(x) || !lelem_alloc_async_packed(x)) {
+    x->precision = 64;
+    lelem_alloc_packed(x);
+    lelem_alloc_async_packed(x);
+    err = MAX_ERR_OUT_OF_MEM;
+  }
+
+  if (sliced) { lelem_sliced(x, x->s_output); }
+  return err;
+}
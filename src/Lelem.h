@@ -0,0 +1,199 @@
+#ifndef YC_L_ELEM_H_
+#define YC_L_ELEM_H_
+
+/****************************************************************
+*  Header files
+*/
+#include "ext.h"
+#include "ext_obex.h"
+#include "Lobjects.h"
+
+/****************************************************************
+*  Element-wise operators
+*
+*  The engine in Lelem.c is shared by all the element-wise externals
+*  (Lmax, Lmin, Ladd, ...): inlets, stored lists, broadcast of single
+*  element lists, zero padding, frames and attributes.
+*
+*  Each external defines its operator at compile time and includes
+*  Lelem_kernel.h once to generate the functions lelem_kernel() and lelem_kernel32().
+*/
+
+/****************************************************************
+*  Arguments of the operator kernel
+*
+*  The input pointers and increments, set by lelem_prepare(),
+*  and the packed lists, set by lelem_packed().
+*/
+typedef struct _lelem_args
+{
+  t_atom    *in[INLETS_MAX];
+  t_mess_int incr[INLETS_MAX];
+  t_atom    *out;
+  t_int32    inlets;
+  float     *in32[INLETS_MAX];
+  float     *out32;
+} t_lelem_args;
+
+/****************************************************************
+*  Request to the worker, see the async attribute
+*
+*  The computations are stamped in order, to tell if the result of a request
+*  is more recent than the output list computed synchronously.
+*/
+typedef struct _lelem_req
+{
+  t_uint32 stamp;
+  t_bool   output;   // send the result out once delivered
+} t_lelem_req;
+
+#define STAMP_NEWER(a, b) ((t_int32)((a) - (b)) > 0)
+
+/****************************************************************
+*  Max object structure
+*/
+typedef struct _lelem
+{
+  t_object obj;
+
+  // Inlets, proxies and outlets
+  void *inl_proxies[INLETS_MAX];   // the first one is unused
+  long  inl_proxy_ind;
+  void *outl_list;
+
+  // Input and output messages
+  t_mess_struct i_lists[INLETS_MAX];
+  t_mess_struct o_list[1];
+  t_mess_struct o_frames[1];
+
+  // Inboxes for the lists of the cold inlets, the first one is unused
+  t_mess_inbox  inboxes[INLETS_MAX];
+
+  // Lazy allocation:  true until the lists are allocated on first use
+  t_bool alloc_pending;
+
+  // Arguments of the operator kernel, set by lelem_prepare()
+  t_lelem_args args[1];
+
+  // Asynchronous processing of long lists, see the async attribute
+  t_mess_worker worker[1];
+  t_mess_struct a_next[INLETS_MAX];  // inputs of the pending request
+  t_mess_struct a_work[INLETS_MAX];  // inputs of the running request
+  t_lelem_args  a_args[1];
+  t_mess_struct a_out[1];            // output of the running request
+  t_mess_struct a_done[1];           // output waiting to be delivered
+  t_mess_struct a_deliv[1];          // output delivered
+  float        *a_p_lists[INLETS_MAX]; // inputs of the running request, packed with a precision of 32
+  float        *a_p_out;
+  t_lelem_req   a_next_req;          // requests of a_next, a_work and a_done
+  t_lelem_req   a_work_req;
+  t_lelem_req   a_done_req;
+  t_uint32      a_deliv_stamp;
+  t_uint32      o_stamp;             // stamp of the computation of o_list
+  t_uint32      stamps;              // stamp of the last computation
+
+  // Processing of long lists over several ticks, see the budget attribute
+  t_mess_slicer slicer[1];
+  t_bool        s_output;            // output once the processing is complete
+  t_bool        s_packed;            // process the packed lists
+
+  // Lists packed as 32 bit floats, see the precision attribute
+  float        *p_lists[INLETS_MAX]; // the cold lists are packed when stored, with a zero tail
+  t_mess_int    p_len[INLETS_MAX];   // length packed, zero beyond
+  t_bool        p_valid[INLETS_MAX]; // false if the list holds atoms that are not numbers
+  float        *p_out;
+
+  // Attributes
+  t_mess_int maxlen;     // maximum list length
+  char       warnings;   // report warnings or not
+  t_int32    inlets;     // number of inlets
+  char       largepages; // allocate large lists on large pages
+  char       inbox;      // post the lists of the cold inlets to inboxes
+  t_mess_int async;      // minimum output length to process asynchronously, 0 for never
+  char       drop;       // requests dropped when busy:  WORKER_DROP_OLDER or WORKER_DROP_NEWER
+  t_mess_int budget;     // time budget per tick in microseconds, 0 to process at once
+  t_int32    precision;  // 64, or 32 to process numeric lists packed as 32 bit floats
+
+} t_lelem;
+
+/****************************************************************
+*  Function declarations
+*/
+
+/****************************************************************
+*  Create and register the class of an element-wise external
+*
+*  To be called from ext_main().
+*/
+void  lelem_class_new (const char *name, const char *assist_out, t_int32 inlets_def);
+
+void *lelem_new       (t_symbol *sym, long argc, t_atom *argv);
+void  lelem_free      (t_lelem *x);
+void  lelem_assist    (t_lelem *x, void *b, long msg, long arg, char *dst);
+
+void  lelem_bang      (t_lelem *x);
+void  lelem_int       (t_lelem *x, t_atom_long n);
+void  lelem_float     (t_lelem *x, double f);
+void  lelem_list      (t_lelem *x, t_symbol *sym, long argc, t_atom *argv);
+void  lelem_anything  (t_lelem *x, t_symbol *sym, long argc, t_atom *argv);
+void  lelem_frames    (t_lelem *x, t_symbol *sym, long argc, t_atom *argv);
+void  lelem_clear     (t_lelem *x);
+void  lelem_post      (t_lelem *x);
+
+void  lelem_input     (t_lelem *x, t_mess_int inlet);
+t_mess lelem_target   (t_lelem *x, t_mess_int inlet);
+void  lelem_inbox_take (t_lelem *x);
+t_mess_int lelem_out_len (t_lelem *x, t_mess inputs);
+void  lelem_prepare   (t_lelem *x, t_lelem_args *args, t_mess inputs, t_mess out);
+void  lelem_action    (t_lelem *x);
+t_bool lelem_pack     (t_lelem *x, t_int32 k);
+t_bool lelem_packed   (t_lelem *x);
+t_mess_int lelem_pack_atoms (float *vals, t_atom *atoms, t_mess_int len);
+void  lelem_pack_free (t_lelem *x, t_int32 k);
+void  lelem_output    (t_lelem *x);
+t_max_err lelem_alloc (t_lelem *x);
+t_bool lelem_alloc_inboxes (t_lelem *x);
+t_bool lelem_alloc_async (t_lelem *x);
+t_bool lelem_alloc_packed (t_lelem *x);
+t_bool lelem_alloc_async_packed (t_lelem *x);
+void  lelem_move_lists (t_lelem *x);
+void  lelem_free_lists (t_lelem *x);
+
+t_bool lelem_async         (t_lelem *x, t_bool output);
+void  lelem_async_take    (t_lelem *x);
+void  lelem_async_run     (t_lelem *x);
+t_bool lelem_async_packed (t_lelem *x);
+void  lelem_async_pack_free (t_lelem *x);
+void  lelem_async_give    (t_lelem *x);
+void  lelem_async_deliver (t_lelem *x);
+
+void  lelem_sliced        (t_lelem *x, t_bool output);
+void  lelem_slice_step    (t_lelem *x, t_mess_int beg, t_mess_int end);
+void  lelem_slice_done    (t_lelem *x);
+
+t_max_err lelem_maxlen_set (t_lelem *x, void *attr, long argc, t_atom *argv);
+t_max_err lelem_inlets_set (t_lelem *x, void *attr, long argc, t_atom *argv);
+t_max_err lelem_largepages_set (t_lelem *x, void *attr, long argc, t_atom *argv);
+t_max_err lelem_inbox_set  (t_lelem *x, void *attr, long argc, t_atom *argv);
+t_max_err lelem_async_set  (t_lelem *x, void *attr, long argc, t_atom *argv);
+t_max_err lelem_precision_set (t_lelem *x, void *attr, long argc, t_atom *argv);
+
+/****************************************************************
+*  Operator kernel
+*
+*  Generated for each external by Lelem_kernel.h.
+*  Computes the atoms of the output list in the range [beg, end),
+*  with the arguments set by lelem_prepare().
+*/
+void  lelem_kernel    (t_lelem_args *args, t_mess_int beg, t_mess_int end);
+
+/****************************************************************
+*  Operator kernel on lists packed as 32 bit floats
+*
+*  Same as lelem_kernel(), with the packed lists set by lelem_packed()
+*  or lelem_async_packed().
+*  The output atoms are all floats.
+*/
+void  lelem_kernel32  (t_lelem_args *args, t_mess_int beg, t_mess_int end);
+
+#endif
@@ -0,0 +1,99 @@
+/****************************************************************
+*  Template for the kernel of an element-wise operator
+*
+*  To be included once in the source file of an external, after defining:
+*    LELEM_OP_LONG(a, b, k)   the operation on two ints, b being from the list in inlet k
+*    LELEM_OP_FLOAT(a, b, k)  the operation on two floats, b being from the list in inlet k
+*    LELEM_INT_OUTPUT         1 if two ints give an int, 0 if the output is always a float
+*
+*  The lists are folded from left to right:  op(op(in0, in1), in2) ...
+*/
+#include "Lelem.h"
+
+#if !defined(LELEM_OP_LONG) || !defined(LELEM_OP_FLOAT) || !defined(LELEM_INT_OUTPUT)
+#error "Define LELEM_OP_LONG, LELEM_OP_FLOAT and LELEM_INT_OUTPUT before including Lelem_kernel.h"
+#endif
+
+/****************************************************************
+*  Function declarations
+*/
+void lelem_atom (t_lelem_args *args, t_atom *out, t_mess_int i);
+
+/****************************************************************
+*  Helper function to determine one atom of the output list
+*/
+__inline void lelem_atom(t_lelem_args *args, t_atom *out, t_mess_int i)
+{
+  t_atom *in_k;
+  long type1, type2;
+
+  *out = *(args->in[0] + args->incr[0] * i);
+  if (atom_gettype(out) == A_NOTHING) { atom_setlong(out, 0); }
+  type1 = atom_gettype(out);
+
+  // Fold the remaining lists into the output atom
+  for (t_int32 k = 1; k < args->inlets; k++) {
+
+    in_k = args->in[k] + args->incr[k] * i;
+    type2 = ATOM_TYPE(in_k);
+
+    // If either input is not a number, the output is left unchanged
+    if (((type1 != A_LONG) && (type1 != A_FLOAT)) || ((type2 != A_LONG) && (type2 != A_FLOAT))) {
+      continue;
+    }
+#if LELEM_INT_OUTPUT
+    // ... if both inputs are integers, the output is an integer
+    else if ((type1 == A_LONG) && (type2 == A_LONG)) {
+      atom_setlong(out, LELEM_OP_LONG(atom_getlong(out), atom_getlong(in_k), k));
+    }
+#endif
+    // ... otherwise the output is a float
+    else {
+      atom_setfloat(out, LELEM_OP_FLOAT(atom_getfloat(out), atom_getfloat(in_k), k));
+      type1 = A_FLOAT;
+    }
+  }
+}
+
+/****************************************************************
+*  Compute the atoms of the output list in the range [beg, end)
+*/
+void lelem_kernel(t_lelem_args *args, t_mess_int beg, t_mess_int end)
+{
+  TRACE("lelem_kernel");
+
+  t_atom *out = args->out;
+
+  for (t_mess_int i = beg; i < end; i++) { lelem_atom(args, out + i, i); }
+}
+
+/****************************************************************
+*  Compute the atoms of the output list in the range [beg, end),
+*  from the lists packed as 32 bit floats
+*
+*  The lists are folded one at a time over the whole range, in loops
+*  simple enough for the compiler to vectorize, then converted to atoms.
+*/
+void lelem_kernel32(t_lelem_args *args, t_mess_int beg, t_mess_int end)
+{
+  TRACE("lelem_kernel32");
+
+  float *out = args->out32;
+  float *in_k = args->in32[0];
+  float b;
+
+  if (args->incr[0]) { for (t_mess_int i = beg; i < end; i++) { out[i] = in_k[i]; } }
+  else { b = in_k[0]; for (t_mess_int i = beg; i < end; i++) { out[i] = b; } }
+
+  // Fold the remaining lists, broadcasting the single element ones
+  for (t_int32 k = 1; k < args->inlets; k++) {
+    in_k = args->in32[k];
+    if (args->incr[k]) {
+      for (t_mess_int i = beg; i < end; i++) { out[i] = (float)LELEM_OP_FLOAT(out[i], in_k[i], k); } }
+    else {
+      b = in_k[0];
+      for (t_mess_int i = beg; i < end; i++) { out[i] = (float)LELEM_OP_FLOAT(out[i], b, k); } }
+  }
+
+  for (t_mess_int i = beg; i < end; i++) { atom_setfloat(args->out + i, out[i]); }
+}
@@ -9,6 +9,16 @@
 *    - The external uses the new style Max object and attributes.
 *    - The arrays to store lists and messages are resizable.
 *    - Non int, float or list messages can be processed (starting with a symbol).
+*    - The stored list can be shared between objects without copies:  publish <name> / share <name>
+*    - The stored list can be bound to a named table, common to the Lfind objects:  @table <name>
+*    - The search index of an ascending stored list is built once, and searched by bisection.
+*    - The stored list is double buffered, and can be written from the main thread
+*      while it is searched from the scheduler thread.
+*    - Long lists can be searched by a worker thread, with the async attribute.
+*    - The search index can be built over several scheduler ticks, with the budget attribute.
+*    - Batches of targets can be searched in one message:  targets <list>
+*      Long batches are split across the threads of the pool, with the parallel attribute.
+*    - The search index can hold 32 bit floats, with the precision attribute.
 */
 
 /****************************************************************
@@ -28,20 +38,91 @@ typedef struct _lfind
   // Inlets, proxies and outlets
   void *inl_proxy;
   long  inl_proxy_ind;
-  void *outl_float;
+  void *outl_float;       // position (float), or positions of a batch of targets (list)
 
   // Input messages
-  t_mess_struct i_list_2[1];
+  t_mess_table  i_table[1];  // private table for the stored list
+  t_mess_table *table;       // table searched:  i_table or a named table
 
-  // Output variable
+  // Output variables
   double     o_float;
+  t_mess_struct o_list[1];  // positions of a batch of targets
+
+  // Asynchronous search in long lists, see the async attribute
+  t_mess_worker worker[1];
+  double     a_next;     // target of the pending request
+  double     a_work;     // target of the running request
+  double     a_pos;      // position found by the running request
+  t_bool     a_found;
+  double     a_done;     // position waiting to be delivered
+  t_bool     a_done_found;
+
+  // Building of the search index over several ticks, see the budget attribute
+  t_mess_slicer  slicer[1];
+  t_mess_table  *s_table;
+  t_mess         s_mess;     // list the index is built from
+  struct _lfind_index *s_index;
+  t_uint32       s_seq;      // sequence number of the table when the building started
 
   // Attributes
   t_mess_int maxlen;     // maximum list length
   char       warnings;   // report warnings or not
+  char       largepages; // allocate large lists on large pages
+  t_symbol  *table_name; // name of the table bound to, or empty
+  t_mess_int async;      // minimum stored length to search asynchronously, 0 for never
+  char       drop;       // requests dropped when busy:  WORKER_DROP_OLDER or WORKER_DROP_NEWER
+  t_mess_int budget;     // time budget per tick in microseconds, 0 to build the index at once
+  t_mess_int parallel;   // minimum batch length split across threads, 0 for never
+  t_int32    precision;  // precision of the search index:  64, or 32 for packed floats
+
+  // Lazy allocation:  true until the lists are allocated on first use
+  t_bool alloc_pending;
 
 } t_lfind;
 
+/****************************************************************
+*  Search index of a stored list, shared by the objects bound to its table
+*
+*  With a precision of 32, the values are packed as floats:  see LFIND_VALS32().
+*/
+typedef struct _lfind_index
+{
+  t_bool     ascending;  // true if the values are in ascending order
+  t_bool     ready;      // false while the index is being built
+  t_int32    precision;  // precision of the values, set by the object writing the list
+  t_int32    alloc;      // precision the values are allocated for
+  t_mess_int len;
+  double     vals[1];    // values of the stored list
+} t_lfind_index;
+
+#define LFIND_VALS32(index) ((float *)(index)->vals)
+#define LFIND_VAL(index, i) (((index)->precision == 32) ? (double)LFIND_VALS32(index)[i] : (index)->vals[i])
+
+/****************************************************************
+*  Arguments of the ranges split across the threads of the pool
+*/
+typedef struct _lfind_build
+{
+  t_lfind_index *index;
+  t_mess         mess;
+} t_lfind_build;
+
+typedef struct _lfind_scan
+{
+  t_atom        *argv;
+  double         f;
+  t_int32_atomic found;  // lowest position of an exact match, or the length if none
+} t_lfind_scan;
+
+typedef struct _lfind_batch
+{
+  t_lfind       *x;
+  t_mess         front;    // stored list searched, read only
+  t_lfind_index *index;    // its index if ready and ascending, NULL otherwise
+  t_atom        *targets;
+  t_atom        *out;      // positions, each range writing its own slice
+} t_lfind_batch;
+
 /****************************************************************
 *  Global class pointer
 */
@@ -59,13 +140,44 @@ void  lfind_int      (t_lfind *x, t_atom_long n);
 void  lfind_float    (t_lfind *x, double f);
 void  lfind_list     (t_lfind *x, t_symbol *sym, long argc, t_atom *argv);
 void  lfind_anything (t_lfind *x, t_symbol *sym, long argc, t_atom *argv);
+void  lfind_targets  (t_lfind *x, t_symbol *sym, long argc, t_atom *argv);
 void  lfind_clear    (t_lfind *x);
+void  lfind_publish  (t_lfind *x, t_symbol *name);
+void  lfind_share    (t_lfind *x, t_symbol *name);
 void  lfind_post     (t_lfind *x);
 
-void  lfind_action   (t_lfind *x, long argc, t_atom *argv, double f);
-void  lfind_output   (t_lfind *x);
-
+t_bool lfind_search   (t_lfind *x, double f, double *pos);
+t_bool lfind_action   (t_lfind *x, long argc, t_atom *argv, double f, double *pos);
+t_bool lfind_action_sorted (t_lfind *x, t_lfind_index *index, double f, double *pos);
+void   lfind_scan_range (t_lfind_scan *scan, t_mess_int beg, t_mess_int end);
+void   lfind_batch_range (t_lfind_batch *batch, t_mess_int beg, t_mess_int end);
+void   lfind_output   (t_lfind *x);
+
+void   lfind_write_end (t_lfind *x);
+t_lfind_index *lfind_index_init (t_mess_table *table, t_int32 b, t_int32 precision);
+void   lfind_index_range (t_lfind_index *index, t_mess mess, t_mess_int beg, t_mess_int end);
+void   lfind_index_build (t_lfind_build *build, t_mess_int beg, t_mess_int end);
+void   lfind_index_sliced (t_lfind *x, t_mess_table *table, t_int32 b);
+void   lfind_slice_step   (t_lfind *x, t_mess_int beg, t_mess_int end);
+void   lfind_slice_done   (t_lfind *x);
+
+t_bool lfind_async         (t_lfind *x, double f);
+void   lfind_async_take    (t_lfind *x);
+void   lfind_async_run     (t_lfind *x);
+void   lfind_async_give    (t_lfind *x);
+void   lfind_async_deliver (t_lfind *x);
+
+t_max_err lfind_alloc      (t_lfind *x);
+void   lfind_move_table    (t_lfind *x);
 t_max_err lfind_maxlen_set (t_lfind *x, void *attr, long argc, t_atom *argv);
+t_max_err lfind_largepages_set (t_lfind *x, void *attr, long argc, t_atom *argv);
+t_max_err lfind_table_set  (t_lfind *x, void *attr, long argc, t_atom *argv);
+t_max_err lfind_precision_set (t_lfind *x, void *attr, long argc, t_atom *argv);
+
+/****************************************************************
+*  Allocation function called by ASSERT_ALLOC
+*/
+#define ALLOC_FUNCTION lfind_alloc
 
 /****************************************************************
 *  Initialization
@@ -89,8 +201,11 @@ void ext_main(void *r)
   class_addmethod(c, (method)lfind_float,    "float",     A_FLOAT, 0);
   class_addmethod(c, (method)lfind_list,     "list",      A_GIMME, 0);
   class_addmethod(c, (method)lfind_anything, "anything",  A_GIMME, 0);
+  class_addmethod(c, (method)lfind_targets,  "targets",   A_GIMME, 0);
   class_addmethod(c, (method)stdinletinfo,   "inletinfo", A_CANT,  0);
   class_addmethod(c, (method)lfind_clear,    "clear",              0);
+  class_addmethod(c, (method)lfind_publish,  "publish",   A_SYM,   0);
+  class_addmethod(c, (method)lfind_share,    "share",     A_SYM,   0);
   class_addmethod(c, (method)lfind_post,     "post",               0);
 
   // Define the class attributes
@@ -109,6 +224,57 @@ void ext_main(void *r)
   CLASS_ATTR_SAVE     (c, "warnings", 0);
   CLASS_ATTR_SELFSAVE (c, "warnings", 0);
 
+  CLASS_ATTR_CHAR     (c, "largepages", 0, t_lfind, largepages);
+  CLASS_ATTR_ORDER    (c, "largepages", 0, "3");
+  CLASS_ATTR_STYLE    (c, "largepages", 0, "onoff");
+  CLASS_ATTR_LABEL    (c, "largepages", 0, "large pages for large lists");
+  CLASS_ATTR_SAVE     (c, "largepages", 0);
+  CLASS_ATTR_SELFSAVE (c, "largepages", 0);
+  CLASS_ATTR_ACCESSORS(c, "largepages", NULL, lfind_largepages_set);
+
+  CLASS_ATTR_SYM      (c, "table", 0, t_lfind, table_name);
+  CLASS_ATTR_ORDER    (c, "table", 0, "4");
+  CLASS_ATTR_LABEL    (c, "table", 0, "name of the table searched");
+  CLASS_ATTR_SAVE     (c, "table", 0);
+  CLASS_ATTR_SELFSAVE (c, "table", 0);
+  CLASS_ATTR_ACCESSORS(c, "table", NULL, lfind_table_set);
+
+  CLASS_ATTR_INT32    (c, "async", 0, t_lfind, async);
+  CLASS_ATTR_ORDER    (c, "async", 0, "5");
+  CLASS_ATTR_LABEL    (c, "async", 0, "minimum length searched asynchronously");
+  CLASS_ATTR_FILTER_MIN(c, "async", 0);
+  CLASS_ATTR_SAVE     (c, "async", 0);
+  CLASS_ATTR_SELFSAVE (c, "async", 0);
+
+  CLASS_ATTR_CHAR     (c, "drop", 0, t_lfind, drop);
+  CLASS_ATTR_ORDER    (c, "drop", 0, "6");
+  CLASS_ATTR_ENUMINDEX(c, "drop", 0, "older newer");
+  CLASS_ATTR_LABEL    (c, "drop", 0, "requests dropped when busy");
+  CLASS_ATTR_FILTER_CLIP(c, "drop", 0, 1);
+  CLASS_ATTR_SAVE     (c, "drop", 0);
+  CLASS_ATTR_SELFSAVE (c, "drop", 0);
+
+  CLASS_ATTR_INT32    (c, "budget", 0, t_lfind, budget);
+  CLASS_ATTR_ORDER    (c, "budget", 0, "7");
+  CLASS_ATTR_LABEL    (c, "budget", 0, "time budget per tick (microseconds)");
+  CLASS_ATTR_FILTER_MIN(c, "budget", 0);
+  CLASS_ATTR_SAVE     (c, "budget", 0);
+  CLASS_ATTR_SELFSAVE (c, "budget", 0);
+
+  CLASS_ATTR_INT32    (c, "parallel", 0, t_lfind, parallel);
+  CLASS_ATTR_ORDER    (c, "parallel", 0, "8");
+  CLASS_ATTR_LABEL    (c, "parallel", 0, "minimum batch of targets split across threads");
+  CLASS_ATTR_FILTER_MIN(c, "parallel", 0);
+  CLASS_ATTR_SAVE     (c, "parallel", 0);
+  CLASS_ATTR_SELFSAVE (c, "parallel", 0);
+
+  CLASS_ATTR_INT32    (c, "precision", 0, t_lfind, precision);
+  CLASS_ATTR_ORDER    (c, "precision", 0, "9");
+  CLASS_ATTR_LABEL    (c, "precision", 0, "precision of the search index (32 or 64 bits)");
+  CLASS_ATTR_SAVE     (c, "precision", 0);
+  CLASS_ATTR_SELFSAVE (c, "precision", 0);
+  CLASS_ATTR_ACCESSORS(c, "precision", NULL, lfind_precision_set);
+
   class_register(CLASS_BOX, c);
   lfind_class = c;
 }
@@ -128,14 +294,30 @@ void *lfind_new(t_symbol *sym, long argc, t_atom *argv)
   // Set inlets, outlets and proxies
   x->inl_proxy_ind = 0;
   x->inl_proxy = proxy_new((t_object *)x, 1L, &x->inl_proxy_ind);
-  x->outl_float = floatout((t_object *)x);
+  x->outl_float = outlet_new((t_object *)x, NULL);
 
   // Initialize the attributes
   x->maxlen = 0;
   x->warnings = 1;
+  x->largepages = 0;
+  x->table_name = gensym("");
+  x->async = 0;
+  x->drop = WORKER_DROP_OLDER;
+  x->budget = 0;
+  x->parallel = 0;
+  x->precision = 64;
 
   // Initialize the message structures
-  mess_init(x->i_list_2);
+  table_init(x->i_table);
+  mess_init(x->o_list);
+  x->table = x->i_table;
+  worker_init(x->worker);
+  slicer_init(x->slicer);
+  x->s_table = NULL;
+  x->s_mess = NULL;
+  x->s_index = NULL;
+  x->s_seq = 0;
+  x->alloc_pending = false;
 
   // Process the attribute arguments
   attr_args_process(x, (short)argc, argv);
@@ -149,19 +331,26 @@ void *lfind_new(t_symbol *sym, long argc, t_atom *argv)
 
   // Process the non attribute arguments to set the left input list if necessary
   argc = (t_mess_int)attr_args_offset((short)argc, argv);
+  if (argc && x->alloc_pending) { lfind_alloc(x); }
   switch (argc) {
 
   // Zero arguments:  do nothing
   case 0: break;
 
   // One argument:  initialize the stored list to a constant list
-  case 1: mess_fill_float(x->i_list_2, atom_getfloat(argv), 1); break;
+  case 1:
+    mess_fill_float(table_write_begin(x->table), atom_getfloat(argv), 1);
+    lfind_write_end(x);
+    break;
 
   // More than one:  initialize the stored list using the arguments
-  default:
-    mess_set_list(x->i_list_2, argc, argv, x, x->warnings);
-    mess_set_type(x->i_list_2);    // determine the proper symbol (int, float, list, message)
-    break;
+  default: {
+    t_mess back = table_write_begin(x->table);
+    mess_set_list(back, argc, argv, x, x->warnings);
+    mess_zpad(back);
+    mess_set_type(back);    // determine the proper symbol (int, float, list, message)
+    lfind_write_end(x);
+    break; }
   }
 
   // Remaining variables
@@ -180,8 +369,12 @@ void lfind_free(t_lfind *x)
   // Free the proxies
   freeobject((t_object *)x->inl_proxy);
 
-  // Free the message structures
-  mess_clear(x->i_list_2);
+  // Stop the worker and the slicer, free the message structures and release the named table
+  worker_stop(x->worker);
+  slicer_free(x->slicer);
+  if (x->table != x->i_table) { table_unbind(x->table); }
+  table_clear(x->i_table);
+  mess_clear(x->o_list);
 }
 
 /****************************************************************
@@ -199,7 +392,7 @@ void lfind_assist(t_lfind *x, void *b, long msg, long arg, char *dst)
     break;
   case ASSIST_OUTLET:
     switch (arg) {
-    case 0: sprintf(dst, "position of target in list (float)"); break;
+    case 0: sprintf(dst, "position of target in list (float), or positions of targets (list)"); break;
     default: break;
     }
     break;
@@ -239,11 +432,15 @@ void lfind_float(t_lfind *x, double f)
 
   // Left inlet:  find the number in the stored list
   case 0:
-    lfind_action(x, x->i_list_2->len_cur, x->i_list_2->list, f);
+    if (lfind_async(x, f)) { break; }
+    if (lfind_search(x, f, &x->o_float)) { lfind_output(x); }
     break;
 
   // Right inlet:  store a constant list
-  case 1: mess_fill_float(x->i_list_2, (t_atom_float)f, 1); break;
+  case 1:
+    mess_fill_float(table_write_begin(x->table), (t_atom_float)f, 1);
+    lfind_write_end(x);
+    break;
   }
 }
 
@@ -262,15 +459,24 @@ void lfind_list(t_lfind *x, t_symbol *sym, long argc, t_atom *argv)
   switch (proxy_getinlet((t_object *)x)) {
 
   // Left inlet:  search the first stored value in the incoming list
-  case 0:
-    lfind_action(x, argc, argv, atom_getfloat(x->i_list_2->list));
-    break;
+  case 0: {
+    t_uint32 seq;
+    double f;
+    do {
+      seq = table_read_begin(x->table);
+      f = atom_getfloat(x->table->mess[TABLE_FRONT(seq)].list);
+    } while (table_read_retry(x->table, seq));
+
+    if (lfind_action(x, argc, argv, f, &x->o_float)) { lfind_output(x); }
+    break; }
 
   // Right inlet:  store the incoming list
-  case 1:
-    mess_set_list(x->i_list_2, argc, argv, x, x->warnings);
-    mess_zpad(x->i_list_2);
-    break;
+  case 1: {
+    t_mess back = table_write_begin(x->table);
+    mess_set_list(back, argc, argv, x, x->warnings);
+    mess_zpad(back);
+    lfind_write_end(x);
+    break; }
   }
 }
 
@@ -284,6 +490,87 @@ void lfind_anything(t_lfind *x, t_symbol *sym, long argc, t_atom *argv)
   WARN(x->warnings, "Invalid input:  int or list expected.");
 }
 
+/****************************************************************
+*  Search a batch of targets in the stored list
+*
+*  Outputs the list of the positions found, with -1 for the targets not found.
+*  The batch is searched in one snapshot of the stored list, and is split
+*  across the threads of the pool if at least as long as the parallel attribute.
+*/
+void lfind_targets(t_lfind *x, t_symbol *sym, long argc, t_atom *argv)
+{
+  TRACE("lfind_targets");
+
+  ASSERT_ALLOC;
+
+  if (proxy_getinlet((t_object *)x) != 0) {
+    ERR("targets:  Batches of targets should go into the left inlet.");
+    return;
+  }
+
+  // Clip the batch if it exceeds the maximum length
+  if (argc > x->maxlen) {
+    WARN(x->warnings, "targets:  Batch truncated from length %i to %i.", (t_mess_int)argc, x->maxlen);
+    argc = x->maxlen;
+  }
+  if (argc <= 0) { return; }
+
+  t_mess_table *table = x->table;
+  t_lfind_batch batch;
+  t_uint32 seq;
+
+  batch.x = x;
+  batch.targets = argv;
+  batch.out = x->o_list->list;
+
+  do {
+    seq = table_read_begin(table);
+    batch.front = table->mess + TABLE_FRONT(seq);
+    batch.index = (t_lfind_index *)table->index[TABLE_FRONT(seq)];
+    if (batch.index && !(batch.index->ready && batch.index->ascending)) { batch.index = NULL; }
+
+    if (x->parallel) { pool_for_min((t_pool_fn)lfind_batch_range, &batch, (t_mess_int)argc, x->parallel); }
+    else { lfind_batch_range(&batch, 0, (t_mess_int)argc); }
+  } while (table_read_retry(table, seq));
+
+  x->o_list->len_cur = (t_mess_int)argc;
+  mess_set_type(x->o_list);
+  mess_outlet(x->o_list, x->outl_float);
+}
+
+/****************************************************************
+*  Publish the stored list under a name, for other objects to share it
+*/
+void lfind_publish(t_lfind *x, t_symbol *name)
+{
+  TRACE("lfind_publish");
+
+  ASSERT_ALLOC;
+
+  table_publish(x->table, (name != gensym("")) ? name : NULL);
+}
+
+/****************************************************************
+*  Share the stored list published by another object, without copying it
+*
+*  Each object copies the list when it is modified.
+*/
+void lfind_share(t_lfind *x, t_symbol *name)
+{
+  TRACE("lfind_share");
+
+  ASSERT_ALLOC;
+
+  t_mess src = mess_published(name);
+  if (!src) { ERR("share:  No list published as \"%s\".", name->s_name); return; }
+
+  if (mess_share(table_write_begin(x->table), src, x)) { lfind_write_end(x); }
+  else {
+    table_write_cancel(x->table);
+    WARN(x->warnings, "share:  The list published as \"%s\" could not be shared.", name->s_name);
+  }
+}
+
 /****************************************************************
 *  Clear the lists
 */
@@ -291,8 +578,12 @@ void lfind_clear(t_lfind *x)
 {
   TRACE("lfind_clear");
 
-  mess_set_empty(x->i_list_2);
-  x->i_list_2->len_cur = 1;
+  ASSERT_ALLOC;
+
+  t_mess back = table_write_begin(x->table);
+  mess_set_empty(back);
+  back->len_cur = 1;
+  lfind_write_end(x);
 }
 
 /****************************************************************
@@ -302,28 +593,287 @@ void lfind_post(t_lfind *x)
 {
   TRACE("lfind_post");
 
-  POST("Max length: %i - Warnings: %i - Position found: %f",
-    x->maxlen, x->warnings, x->o_float);
-  mess_post(x->i_list_2, "Stored input list", x);
+  POST("Max length: %i - Warnings: %i - Table: %s - Position found: %f",
+    x->maxlen, x->warnings, x->table_name->s_name, x->o_float);
+  mess_post(x->table->mess + TABLE_FRONT(table_read_begin(x->table)), "Stored input list", x);
+}
+
+/****************************************************************
+*  Search a number in the stored list
+*
+*  Ascending lists are searched by bisection in the index of the table.
+*  The search is repeated if the list was written from another thread meanwhile.
+*  Sets the position found and returns true, or returns false if none.
+*/
+t_bool lfind_search(t_lfind *x, double f, double *pos)
+{
+  TRACE("lfind_search");
+
+  t_mess_table *table = x->table;
+  t_lfind_index *index;
+  t_mess front;
+  t_uint32 seq;
+  t_bool found;
+
+  do {
+    seq = table_read_begin(table);
+    front = table->mess + TABLE_FRONT(seq);
+    index = (t_lfind_index *)table->index[TABLE_FRONT(seq)];
+
+    if (index && index->ready && index->ascending) { found = lfind_action_sorted(x, index, f, pos); }
+    else { found = lfind_action(x, front->len_cur, front->list, f, pos); }
+  } while (table_read_retry(table, seq));
+
+  return found;
+}
+
+/****************************************************************
+*  Search the targets in the range [beg, end) of a batch
+*
+*  The ranges only read the stored list and its index, and write their own slice
+*  of the output, so that they can be searched concurrently.
+*/
+void lfind_batch_range(t_lfind_batch *batch, t_mess_int beg, t_mess_int end)
+{
+  t_mess front = batch->front;
+  double f, pos;
+  t_bool found;
+
+  for (t_mess_int i = beg; i < end; i++) {
+    f = atom_getfloat(batch->targets + i);
+    if (batch->index) { found = lfind_action_sorted(batch->x, batch->index, f, &pos); }
+    else { found = lfind_action(batch->x, front->len_cur, front->list, f, &pos); }
+    atom_setfloat(batch->out + i, found ? pos : -1);
+  }
+}
+
+/****************************************************************
+*  Finish writing the stored list:  build its index and flip the buffers
+*
+*  With the budget attribute, the index is built over several ticks once the
+*  buffers are flipped, and the list is searched linearly until it is ready.
+*/
+void lfind_write_end(t_lfind *x)
+{
+  TRACE("lfind_write_end");
+
+  t_mess_table *table = x->table;
+  t_int32 b = TABLE_BACK(table);
+  t_lfind_index *index = lfind_index_init(table, b, x->precision);
+
+  slicer_cancel(x->slicer);
+  if (index && !x->budget) {
+    t_lfind_build build = { index, table->mess + b };
+    pool_for((t_pool_fn)lfind_index_build, &build, index->len);
+    index->ready = true;
+  }
+
+  table_write_end(table);
+
+  if (index && x->budget) { lfind_index_sliced(x, table, b); }
+}
+
+/****************************************************************
+*  Prepare the search index of a buffer of a table
+*
+*  The index is kept by the table, and built once for all the objects bound to it.
+*  It is allocated for the maximum length, in floats or doubles depending on the precision,
+*  and reallocated when written with another precision.
+*  Returns NULL if the list is not allocated, or the index could not be allocated.
+*/
+t_lfind_index *lfind_index_init(t_mess_table *table, t_int32 b, t_int32 precision)
+{
+  t_mess mess = table->mess + b;
+  t_lfind_index *index = (t_lfind_index *)table->index[b];
+  size_t size = (precision == 32) ? sizeof(float) : sizeof(double);
+
+  if (MESS_IS_NULL(mess)) { return NULL; }
+
+  if (index && (index->alloc != precision)) {
+    sysmem_freeptr(index);
+    index = table->index[b] = NULL;
+  }
+
+  if (!index) {
+    index = (t_lfind_index *)sysmem_newptr((long)(sizeof(t_lfind_index) + size * MAX(mess->len_max - 1, 0)));
+    if (!index) { return NULL; }
+    index->alloc = precision;
+    table->index[b] = index;
+  }
+
+  index->len = mess->len_cur;
+  index->precision = precision;
+  index->ascending = true;
+  index->ready = false;
+  return index;
+}
+
+/****************************************************************
+*  Build the search index in the range [beg, end)
+*
+*  The ranges can be built in any order, or concurrently:  the first value
+*  of a range is compared to the stored list rather than to the index.
+*  With a precision of 32, the order is tested on the rounded values.
+*/
+void lfind_index_range(t_lfind_index *index, t_mess mess, t_mess_int beg, t_mess_int end)
+{
+  t_bool is_32 = (index->precision == 32);
+  float *vals32 = LFIND_VALS32(index);
+  double prev = (beg > 0) ? atom_getfloat(mess->list + beg - 1) : 0;
+  double val;
+
+  if (is_32) { prev = (float)prev; }
+
+  for (t_mess_int i = beg; i < end; i++) {
+    val = atom_getfloat(mess->list + i);
+    if (is_32) { vals32[i] = (float)val; val = vals32[i]; }
+    else { index->vals[i] = val; }
+
+    if ((i > 0) && !(val >= prev)) { index->ascending = false; }
+    prev = val;
+  }
+}
+
+void lfind_index_build(t_lfind_build *build, t_mess_int beg, t_mess_int end)
+{
+  lfind_index_range(build->index, build->mess, beg, end);
+}
+
+/****************************************************************
+*  Build the search index over several ticks, within the time budget
+*/
+void lfind_index_sliced(t_lfind *x, t_mess_table *table, t_int32 b)
+{
+  TRACE("lfind_index_sliced");
+
+  x->s_table = table;
+  x->s_mess = table->mess + b;
+  x->s_index = (t_lfind_index *)table->index[b];
+  x->s_seq = (t_uint32)table->seq;
+
+  if (!slicer_setup(x->slicer, x, (method)lfind_slice_step, (method)lfind_slice_done)) {
+    lfind_slice_step(x, 0, x->s_index->len);
+    lfind_slice_done(x);
+    return;
+  }
+
+  slicer_start(x->slicer, x->s_index->len, x->budget);
+}
+
+/****************************************************************
+*  Slicer functions:  build a range of the index, and make it ready once complete
+*
+*  The building is abandoned if the table is written again meanwhile.
+*/
+void lfind_slice_step(t_lfind *x, t_mess_int beg, t_mess_int end)
+{
+  if ((t_uint32)x->s_table->seq != x->s_seq) { slicer_cancel(x->slicer); return; }
+
+  lfind_index_range(x->s_index, x->s_mess, beg, end);
+}
+
+void lfind_slice_done(t_lfind *x)
+{
+  TRACE("lfind_slice_done");
+
+  if ((t_uint32)x->s_table->seq != x->s_seq) { return; }
+
+  MESS_BARRIER();
+  x->s_index->ready = true;
+}
+
+/****************************************************************
+*  The list action for an ascending list, by bisection
+*
+*  Gives the same position as lfind_action(), or with a precision of 32,
+*  the position in the list and the target both rounded to 32 bit floats.
+*/
+t_bool lfind_action_sorted(t_lfind *x, t_lfind_index *index, double f, double *pos)
+{
+  TRACE("lfind_action_sorted");
+
+  t_mess_int lo = 0;
+  t_mess_int hi = index->len;
+  t_mess_int mid;
+
+  // Find the first value not less than f
+  if (index->precision == 32) {
+    float *vals32 = LFIND_VALS32(index);
+    float f32 = (float)f;
+    while (lo < hi) {
+      mid = lo + (hi - lo) / 2;
+      if (vals32[mid] < f32) { lo = mid + 1; }
+      else { hi = mid; }
+    }
+    f = f32;
+  }
+  else {
+    double *vals = index->vals;
+    while (lo < hi) {
+      mid = lo + (hi - lo) / 2;
+      if (vals[mid] < f) { lo = mid + 1; }
+      else { hi = mid; }
+    }
+  }
+
+  // Exact match
+  if ((lo < index->len) && (LFIND_VAL(index, lo) == f)) {
+    *pos = lo;
+    return true;
+  }
+
+  // If f is out of the range of the list return
+  if ((lo == 0) || (lo == index->len)) { return false; }
+
+  // Interpolate
+  double val_lo = LFIND_VAL(index, lo - 1);
+  *pos = (f - val_lo) / (LFIND_VAL(index, lo) - val_lo) + (lo - 1);
+  return true;
+}
+
+/****************************************************************
+*  Look for the first exact match in the range [beg, end)
+*
+*  The ranges are scanned concurrently for long lists, and the lowest
+*  position is kept. A range stops once a lower match is found.
+*/
+void lfind_scan_range(t_lfind_scan *scan, t_mess_int beg, t_mess_int end)
+{
+  t_int32 found;
+
+  for (t_mess_int i = beg; (i < end) && (i < scan->found); i++) {
+    if (atom_getfloat(scan->argv + i) == scan->f) {
+      do { found = scan->found; }
+      while ((i < found) && !ATOMIC_COMPARE_SWAP32(found, (t_int32)i, &scan->found));
+      return;
+    }
+  }
 }
 
 /****************************************************************
 *  The specific list action
+*
+*  Sets the position found and returns true, or returns false if none.
 */
-void lfind_action(t_lfind *x, long argc, t_atom *argv, double f)
+t_bool lfind_action(t_lfind *x, long argc, t_atom *argv, double f, double *pos)
 {
   TRACE("lfind_action");
 
   t_mess_int incr1 = 1;
   t_mess_int incr2 = 1;
 
+  if (argc <= 0) { return false; }
+
   // Look for exact matches first
-  for (t_mess_int i = 0; i < argc; i++) {
-    if (atom_getfloat(argv + i) == f) {
-      x->o_float = i;
-      lfind_output(x);
-      return;
-    }
+  t_lfind_scan scan;
+  scan.argv = argv;
+  scan.f = f;
+  scan.found = (t_int32)argc;
+  pool_for((t_pool_fn)lfind_scan_range, &scan, (t_mess_int)argc);
+
+  if (scan.found < argc) {
+    *pos = scan.found;
+    return true;
   }
 
   double argf, less_than_val;
@@ -358,7 +908,7 @@ void lfind_action(t_lfind *x, long argc, t_atom *argv, double f)
   }
 
   // ... if none return
-  else { return; }
+  else { return false; }
 
   // Loop forward to find the lowest value still more than f
   more_than_ind = -1;
@@ -380,13 +930,85 @@ void lfind_action(t_lfind *x, long argc, t_atom *argv, double f)
   }
 
   // ... if none return
-  if (more_than_ind == -1) { return; }
+  if (more_than_ind == -1) { return false; }
 
-  // Interpolate and output
-  x->o_float = (f - atom_getfloat(argv + less_than_ind))
+  // Interpolate
+  *pos = (f - atom_getfloat(argv + less_than_ind))
     / (atom_getfloat(argv + more_than_ind) - atom_getfloat(argv + less_than_ind))
     * (more_than_ind - less_than_ind) + less_than_ind;
-  lfind_output(x);
+  return true;
+}
+
+/****************************************************************
+*  Search asynchronously, if the stored list is long enough
+*
+*  The worker searches the table, which can be read from any thread,
+*  and the position is delivered later.
+*  Returns false if the search should be done synchronously.
+*/
+t_bool lfind_async(t_lfind *x, double f)
+{
+  TRACE("lfind_async");
+
+  if (!x->async) { return false; }
+
+  t_uint32 seq = table_read_begin(x->table);
+  if (x->table->mess[TABLE_FRONT(seq)].len_cur < x->async) { return false; }
+
+  if (!worker_start(x->worker, x, (method)lfind_async_take, (method)lfind_async_run,
+    (method)lfind_async_give, (method)lfind_async_deliver)) {
+    WARN(x->warnings, "async:  The worker thread could not be started.");
+    return false;
+  }
+
+  worker_lock(x->worker);
+  if ((x->drop == WORKER_DROP_OLDER) || !worker_busy(x->worker)) {
+    x->a_next = f;
+    worker_request(x->worker, x->drop);
+  }
+  worker_unlock(x->worker);
+
+  return true;
+}
+
+/****************************************************************
+*  Worker functions:  take the target, search it, give the position
+*/
+void lfind_async_take(t_lfind *x)
+{
+  x->a_work = x->a_next;
+}
+
+void lfind_async_run(t_lfind *x)
+{
+  x->a_found = lfind_search(x, x->a_work, &x->a_pos);
+}
+
+void lfind_async_give(t_lfind *x)
+{
+  x->a_done = x->a_pos;
+  x->a_done_found = x->a_found;
+}
+
+/****************************************************************
+*  Deliver the position found by the worker, called by the qelem on the main thread
+*/
+void lfind_async_deliver(t_lfind *x)
+{
+  TRACE("lfind_async_deliver");
+
+  t_bool ready;
+  double pos;
+
+  worker_lock(x->worker);
+  ready = worker_result(x->worker) && x->a_done_found;
+  pos = x->a_done;
+  worker_unlock(x->worker);
+
+  if (ready) {
+    x->o_float = pos;
+    lfind_output(x);
+  }
 }
 
 /****************************************************************
@@ -417,17 +1039,165 @@ t_max_err lfind_maxlen_set(t_lfind *x, void *attr, long argc, t_atom *argv)
   }
   if (maxlen == x->maxlen) { return MAX_ERR_NONE; }
 
-  // Realloc the lists
-  mess_realloc(x->i_list_2, maxlen, x);
+  // Free the lists, they are allocated on first use
+  worker_stop(x->worker);
+  slicer_cancel(x->slicer);
+  table_clear(x->i_table);
+
+  x->maxlen = maxlen;
+  x->alloc_pending = true;
+  return MAX_ERR_NONE;
+}
 
-  // Test the allocation
-  if (MESS_IS_NULL(x->i_list_2)) {
-    mess_clear(x->i_list_2);
+/****************************************************************
+*  Allocate the lists
+*
+*  Called on first use through ASSERT_ALLOC.
+*/
+t_max_err lfind_alloc(t_lfind *x)
+{
+  TRACE("lfind_alloc");
+
+  x->alloc_pending = false;
+  worker_stop(x->worker);
+  slicer_cancel(x->slicer);
+
+  // Realloc and test the lists
+  mess_realloc(x->o_list, x->maxlen, x);
+  if (MESS_IS_NULL(x->o_list)
+    || !table_realloc(x->i_table, x->maxlen, x->largepages ? MESS_ALLOC_LARGE : MESS_ALLOC_DEFAULT, x)) {
+    mess_clear(x->o_list);
     x->maxlen = 0;
     return MAX_ERR_OUT_OF_MEM;
   }
+
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Move the private table to the allocation policy of the largepages attribute
+*
+*  While the table is searched, each buffer is moved as the back buffer,
+*  set to a copy of the front list, and flipped, so that the stored list is kept.
+*/
+void lfind_move_table(t_lfind *x)
+{
+  TRACE("lfind_move_table");
+
+  t_mess_table *table = x->i_table;
+  char policy = x->largepages ? MESS_ALLOC_LARGE : MESS_ALLOC_DEFAULT;
+  t_bool moved = true;
+  t_mess back, front;
+
+  // Not searched while bound to a named table:  move the buffers in place
+  if (x->table != table) {
+    moved = mess_move_policy(table->mess, policy, x) && moved;
+    moved = mess_move_policy(table->mess + 1, policy, x) && moved;
+  }
+
   else {
-    x->maxlen = maxlen;
-    return MAX_ERR_NONE;
+    for (t_int32 i = 0; (i < 2) && moved; i++) {
+      back = table_write_begin(table);
+      front = table->mess + TABLE_FRONT((t_uint32)table->seq);
+      moved = mess_move_policy(back, policy, x);
+      if (!moved) { table_write_cancel(table); break; }
+
+      back->len_cur = front->len_cur;
+      back->sym = front->sym;
+      back->offset = front->offset;
+      back->len_used = front->len_used;
+      ATOMS_COPY(back->list, front->list, front->len_max);
+      lfind_write_end(x);
+    }
+  }
+
+  if (!moved) { WARN(x->warnings, "largepages:  The stored list could not be moved, and keeps its allocation."); }
+}
+
+/****************************************************************
+*  Setter function for the largepages attribute
+*
+*  The stored list is moved if already allocated, keeping its contents.
+*/
+t_max_err lfind_largepages_set(t_lfind *x, void *attr, long argc, t_atom *argv)
+{
+  TRACE("lfind_largepages_set");
+
+  // If no arguments, do nothing
+  if (!argc || !argv) { return MAX_ERR_GENERIC; }
+
+  char largepages = atom_getlong(argv) ? 1 : 0;
+  if (largepages == x->largepages) { return MAX_ERR_NONE; }
+
+  x->largepages = largepages;
+  if (x->maxlen && !x->alloc_pending) { lfind_move_table(x); }
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Setter function for the table attribute
+*
+*  Binds the stored list to a named table, or to the private one if the name is empty.
+*/
+t_max_err lfind_table_set(t_lfind *x, void *attr, long argc, t_atom *argv)
+{
+  TRACE("lfind_table_set");
+
+  t_symbol *name = (argc && argv) ? atom_getsym(argv) : gensym("");
+  if (name == x->table_name) { return MAX_ERR_NONE; }
+
+  // Stop the worker and the slicer, and release the current table
+  worker_stop(x->worker);
+  slicer_cancel(x->slicer);
+  if (x->table != x->i_table) { table_unbind(x->table); }
+  x->table = x->i_table;
+  x->table_name = gensym("");
+
+  if (name == gensym("")) { return MAX_ERR_NONE; }
+
+  // Bind to the named table, allocated with the maximum length of the first object
+  t_mess_table *table = table_bind(name, x->maxlen ? x->maxlen : MAXLEN_DEF, x);
+  if (!table) { ERR("table:  Allocation error for \"%s\".", name->s_name); return MAX_ERR_OUT_OF_MEM; }
+
+  x->table = table;
+  x->table_name = name;
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Setter function for the precision attribute
+*
+*  Once the list is allocated, it is written again to both buffers of the table,
+*  so that their index is reallocated and rebuilt with the new precision.
+*/
+t_max_err lfind_precision_set(t_lfind *x, void *attr, long argc, t_atom *argv)
+{
+  TRACE("lfind_precision_set");
+
+  // If no arguments, do nothing
+  if (!argc || !argv) { return MAX_ERR_GENERIC; }
+
+  // Get the precision and test the value
+  t_int32 precision = (t_int32)atom_getlong(argv);
+  if ((precision != 32) && (precision != 64)) {
+    WARN(x->warnings, "precision:  Invalid value: %i - Expected: 32 or 64 - Set to 64", precision);
+    precision = 64;
+  }
+
+  if (precision == x->precision) { return MAX_ERR_NONE; }
+
+  x->precision = precision;
+  if (!x->maxlen || x->alloc_pending) { return MAX_ERR_NONE; }
+
+  // Write the stored list again to both buffers, to reallocate and rebuild their index
+  t_mess_table *table = x->table;
+  t_mess back;
+
+  worker_stop(x->worker);
+  for (t_int32 i = 0; i < 2; i++) {
+    back = table_write_begin(table);
+    if (!mess_share(back, table->mess + TABLE_FRONT((t_uint32)table->seq), x)) { table_write_cancel(table); break; }
+    lfind_write_end(x);
   }
-}
\ No newline at end of file
+  return MAX_ERR_NONE;
+}
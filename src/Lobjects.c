@@ -1,5 +1,14 @@
+#include "ext_obex.h"
 #include "Lobjects.h"
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#if !defined(WIN_VERSION)
+#include <unistd.h>
+#endif
+
 /****************************************************************
 *  Extern variables for frequently used symbols
 */
@@ -37,28 +46,106 @@ void mess_init(t_mess mess)
   mess->sym     = sym_null;
   mess->list    = NULL;
   mess->offset  = 0;
+  mess->alloc   = MESS_ALLOC_DEFAULT;
+  mess->refs    = NULL;
+  mess->len_used = 0;
+}
+
+/****************************************************************
+*  Allocate a zero initialized list on large pages
+*
+*  Returns NULL if large pages are not available, for the default allocator to be used.
+*  The list is written once from the calling thread, for first-touch placement.
+*/
+static t_atom *mess_alloc_large(size_t size)
+{
+#if defined(WIN_VERSION)
+  // Large pages need the lock pages in memory privilege, and are zeroed on commit
+  SIZE_T page = GetLargePageMinimum();
+  if (!page) { return NULL; }
+  size = (size + page - 1) / page * page;
+  return (t_atom *)VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+
+#elif defined(__linux__) && defined(MADV_HUGEPAGE)
+  // Transparent huge pages on a 2 MB aligned block
+  void *ptr = NULL;
+  size = (size + MESS_LARGE_MIN - 1) / MESS_LARGE_MIN * MESS_LARGE_MIN;
+  if (posix_memalign(&ptr, MESS_LARGE_MIN, size)) { return NULL; }
+  madvise(ptr, size, MADV_HUGEPAGE);
+  memset(ptr, 0, size);
+  return (t_atom *)ptr;
+
+#else
+  return NULL;
+#endif
+}
+
+/****************************************************************
+*  Free a list allocated by mess_alloc_large()
+*/
+static void mess_free_large(t_atom *list)
+{
+#if defined(WIN_VERSION)
+  VirtualFree(list, 0, MEM_RELEASE);
+#else
+  free(list);
+#endif
+}
+
+/****************************************************************
+*  Release the list of a message structure
+*
+*  Shared lists are only freed when the last reference is released.
+*/
+static void mess_release(t_mess mess)
+{
+  if (!mess->list) { return; }
+
+  if (mess->refs) {
+    if (ATOMIC_DECREMENT(mess->refs) > 0) { mess->list = NULL; mess->refs = NULL; return; }
+    sysmem_freeptr((void *)mess->refs);
+    mess->refs = NULL;
+  }
+
+  if (mess->alloc == MESS_ALLOC_LARGE) { mess_free_large(mess->list); }
+  else { sysmem_freeptr(mess->list); }
+  mess->list = NULL;
 }
 
 /****************************************************************
-*  Allocate the members in a message structure
+*  Allocate the members in a message structure, with an allocation policy
 *
+*  The list is zero initialized by the allocator:  see ATOM_TYPE().
 *  Can be used repeatedly.
 *  It is assumed that mess_init() was called first.
 *  Use mess_clear() to free the allocated memory.
 */
-void mess_realloc(t_mess mess, t_mess_int len_max, void *x)
+void mess_realloc_policy(t_mess mess, t_mess_int len_max, char policy, void *x)
 {
+  size_t size = (size_t)len_max * sizeof(t_atom);
+
   // Free the list if already allocated
-  if (mess->list) { sysmem_freeptr(mess->list); mess->list = NULL; }
+  mess_release(mess);
+
+  // Large lists on large pages, if requested and available
+  mess->alloc = MESS_ALLOC_DEFAULT;
+  if ((policy == MESS_ALLOC_LARGE) && (size >= MESS_LARGE_MIN)) {
+    mess->list = mess_alloc_large(size);
+    if (mess->list) { mess->alloc = MESS_ALLOC_LARGE; }
+  }
 
-  // Allocate the list
-  mess->list = (t_atom *)sysmem_newptr(len_max * sizeof(t_atom));
+  // Otherwise allocate the list, already zero initialized, so that it is not written to
+  // and large allocations are only backed by memory as they are used
+  if (!mess->list) { mess->list = (t_atom *)sysmem_newptrclear((long)size); }
   //DEBUG_ALLOC(mess->list);    @NB
   
   // Test the allocation
   if (mess->list) {
     mess->len_max = len_max;
-    mess_set_empty(mess);
+    mess->len_cur = 0;
+    mess->len_used = 0;
+    mess->offset = 0;
+    mess->sym = sym_empty;
   }
   else {
     mess_init(mess);
@@ -66,22 +153,1051 @@ void mess_realloc(t_mess mess, t_mess_int len_max, void *x)
   }
 }
 
+/****************************************************************
+*  Move the list of a message structure to another allocation policy
+*
+*  The atoms are copied up to the maximum length, and a shared list that is moved becomes private.
+*  Does nothing if the list is not allocated, or would be allocated the same way.
+*/
+t_bool mess_move_policy(t_mess mess, char policy, void *x)
+{
+  if (MESS_IS_NULL(mess)) { return true; }
+  if ((policy == MESS_ALLOC_LARGE) && ((size_t)mess->len_max * sizeof(t_atom) < MESS_LARGE_MIN)) {
+    policy = MESS_ALLOC_DEFAULT; }
+  if (policy == mess->alloc) { return true; }
+
+  t_mess_struct moved[1];
+  mess_init(moved);
+  mess_realloc_policy(moved, mess->len_max, policy, x);
+  if (MESS_IS_NULL(moved)) { return false; }
+
+  ATOMS_COPY(moved->list, mess->list, mess->len_max);
+  mess_release(mess);
+  mess->list  = moved->list;
+  mess->alloc = moved->alloc;
+
+  return true;
+}
+
 /****************************************************************
 *  Free the members in a message structure
 */
 void mess_clear(t_mess mess)
 {
-  if (mess->list) { sysmem_freeptr(mess->list); }
+  mess_release(mess);
   mess_init(mess);
 }
 
+/****************************************************************
+*  Share the list of a message structure with another one
+*
+*  The list is not copied but reference counted, and each message structure
+*  copies it on its next modification (copy-on-write).
+*  Both structures should have the same maximum length.
+*  Returns false if the list could not be shared.
+*/
+t_bool mess_share(t_mess dest, t_mess src, void *x)
+{
+  if (MESS_IS_NULL(src) || (dest == src)) { return false; }
+  if (src->list == dest->list) { return true; }
+
+  if (src->len_max != dest->len_max) {
+    ERR("Lists of different maximum lengths cannot be shared:  %i and %i.", src->len_max, dest->len_max);
+    return false;
+  }
+
+  // Start counting the references
+  if (!src->refs) {
+    src->refs = (t_int32_atomic *)sysmem_newptr(sizeof(t_int32_atomic));
+    if (!src->refs) { ERR("Allocation error."); return false; }
+    *src->refs = 1;
+  }
+
+  ATOMIC_INCREMENT(src->refs);
+  mess_release(dest);
+
+  dest->len_cur = src->len_cur;
+  dest->len_max = src->len_max;
+  dest->sym     = src->sym;
+  dest->list    = src->list;
+  dest->offset  = src->offset;
+  dest->alloc   = src->alloc;
+  dest->refs    = src->refs;
+  dest->len_used = src->len_max;   // the atoms written to the shared list are not tracked
+
+  return true;
+}
+
+/****************************************************************
+*  Make the list of a message structure private before modifying it
+*
+*  If the copy fails, the structure is set to NULL and should be reallocated.
+*/
+void mess_unshare(t_mess mess)
+{
+  if (!mess->refs) { return; }
+
+  // Last reference:  the list is already private
+  if (*mess->refs == 1) {
+    sysmem_freeptr((void *)mess->refs);
+    mess->refs = NULL;
+    return;
+  }
+
+  // Otherwise copy the full list, including the atoms after len_cur
+  t_atom *list = (t_atom *)sysmem_newptr(mess->len_max * sizeof(t_atom));
+  if (list) { ATOMS_COPY(list, mess->list, mess->len_max); }
+
+  mess_release(mess);
+  mess->alloc = MESS_ALLOC_DEFAULT;
+  mess->list = list;
+
+  if (!list) {
+    error("Lobjects:  Allocation error when copying a shared list. Try resetting maxlen.");
+    mess_init(mess);
+  }
+}
+
+/****************************************************************
+*  Published message structures
+*
+*  A short linked list, common to the objects of one external.
+*/
+typedef struct _mess_pub
+{
+  t_symbol *name;
+  t_mess    mess;
+  struct _mess_pub *next;
+} t_mess_pub;
+
+static t_mess_pub *mess_pubs = NULL;
+
+/****************************************************************
+*  Publish a message structure under a name, for other objects to share it
+*/
+void mess_publish(t_mess mess, t_symbol *name)
+{
+  t_mess_pub *pub;
+
+  // Replace the structure already published under the name, if any
+  for (pub = mess_pubs; pub; pub = pub->next) {
+    if (pub->name == name) { pub->mess = mess; return; }
+  }
+
+  pub = (t_mess_pub *)sysmem_newptr(sizeof(t_mess_pub));
+  if (!pub) { error("Lobjects:  Allocation error when publishing %s.", name->s_name); return; }
+
+  pub->name = name;
+  pub->mess = mess;
+  pub->next = mess_pubs;
+  mess_pubs = pub;
+}
+
+/****************************************************************
+*  Remove a message structure from the published ones
+*/
+void mess_unpublish(t_mess mess)
+{
+  t_mess_pub **link = &mess_pubs;
+  t_mess_pub *pub;
+
+  while (*link) {
+    pub = *link;
+    if (pub->mess == mess) { *link = pub->next; sysmem_freeptr(pub); }
+    else { link = &pub->next; }
+  }
+}
+
+/****************************************************************
+*  Get the message structure published under a name, or NULL
+*/
+t_mess mess_published(t_symbol *name)
+{
+  for (t_mess_pub *pub = mess_pubs; pub; pub = pub->next) {
+    if (pub->name == name) { return pub->mess; }
+  }
+  return NULL;
+}
+
+/****************************************************************
+*  Named tables
+*
+*  A hash table from names to tables, common to the objects of one external.
+*/
+static t_hashtab *mess_tables = NULL;
+
+/****************************************************************
+*  Initialize a table that is not bound to a name
+*/
+void table_init(t_mess_table *table)
+{
+  table->name = NULL;
+  table->refs = 1;
+  table->seq = 0;
+  mess_init(table->mess);
+  mess_init(table->mess + 1);
+  table->index[0] = NULL;
+  table->index[1] = NULL;
+  table->pub = NULL;
+}
+
+/****************************************************************
+*  Free the members of a table that is not bound to a name
+*
+*  The lists are unpublished, but the name is kept for table_realloc().
+*/
+void table_clear(t_mess_table *table)
+{
+  for (t_int32 b = 0; b < 2; b++) {
+    mess_unpublish(table->mess + b);
+    mess_clear(table->mess + b);
+    if (table->index[b]) { sysmem_freeptr(table->index[b]); }
+    table->index[b] = NULL;
+  }
+}
+
+/****************************************************************
+*  Allocate the lists of a table, with an allocation policy
+*/
+t_bool table_realloc(t_mess_table *table, t_mess_int len_max, char policy, void *x)
+{
+  table_clear(table);
+  mess_realloc_policy(table->mess, len_max, policy, x);
+  mess_realloc_policy(table->mess + 1, len_max, policy, x);
+
+  if (MESS_IS_NULL(table->mess) || MESS_IS_NULL(table->mess + 1)) {
+    table_clear(table);
+    return false;
+  }
+
+  // Publish the front list again, if the table was published
+  if (table->pub) { mess_publish(table->mess + TABLE_FRONT((t_uint32)table->seq), table->pub); }
+  return true;
+}
+
+/****************************************************************
+*  Bind to the table with a name, creating it if necessary
+*/
+t_mess_table *table_bind(t_symbol *name, t_mess_int len_max, void *x)
+{
+  t_mess_table *table = NULL;
+
+  if (!mess_tables) {
+    mess_tables = hashtab_new(0);
+    if (!mess_tables) { error("Lobjects:  Allocation error for the named tables."); return NULL; }
+    hashtab_flags(mess_tables, OBJ_FLAG_DATA);
+  }
+
+  // Bind to the existing table if any
+  if ((hashtab_lookup(mess_tables, name, (t_object **)&table) == MAX_ERR_NONE) && table) {
+    table->refs++;
+    return table;
+  }
+
+  // ... otherwise create it
+  table = (t_mess_table *)sysmem_newptr(sizeof(t_mess_table));
+  if (!table) { error("Lobjects:  Allocation error for the table %s.", name->s_name); return NULL; }
+
+  table_init(table);
+  table->name = name;
+  if (!table_realloc(table, len_max, MESS_ALLOC_DEFAULT, x)) {
+    error("Lobjects:  Allocation error for the table %s.", name->s_name);
+    sysmem_freeptr(table);
+    return NULL;
+  }
+
+  hashtab_store(mess_tables, name, (t_object *)table);
+  return table;
+}
+
+/****************************************************************
+*  Release a named table, the last object frees it
+*/
+void table_unbind(t_mess_table *table)
+{
+  if (--table->refs > 0) { return; }
+
+  hashtab_chuckkey(mess_tables, table->name);
+  table_clear(table);
+  sysmem_freeptr(table);
+}
+
+/****************************************************************
+*  Publish the front list of a table under a name, or unpublish it if NULL
+*/
+void table_publish(t_mess_table *table, t_symbol *name)
+{
+  mess_unpublish(table->mess);
+  mess_unpublish(table->mess + 1);
+
+  table->pub = name;
+  if (name) { mess_publish(table->mess + TABLE_FRONT((t_uint32)table->seq), name); }
+}
+
+/****************************************************************
+*  Start reading a table:  get the sequence number
+*/
+t_uint32 table_read_begin(t_mess_table *table)
+{
+  t_uint32 seq = (t_uint32)table->seq;
+  MESS_BARRIER();
+  return seq;
+}
+
+/****************************************************************
+*  Finish reading a table:  test if the front buffer was modified while reading
+*
+*  The front buffer of seq is only written once the buffers have been flipped,
+*  by the write that makes the counter reach (seq & ~1) + 3.
+*/
+t_bool table_read_retry(t_mess_table *table, t_uint32 seq)
+{
+  MESS_BARRIER();
+  return ((t_uint32)table->seq - (seq & ~1u)) > 2;
+}
+
+/****************************************************************
+*  Start writing a table:  get the back buffer
+*/
+t_mess table_write_begin(t_mess_table *table)
+{
+  t_uint32 seq;
+
+  // Wait for the writers from other threads, and mark the write as in progress
+  do { seq = (t_uint32)table->seq; }
+  while ((seq & 1) || !ATOMIC_COMPARE_SWAP32((t_int32)seq, (t_int32)(seq + 1), &table->seq));
+
+  return table->mess + TABLE_FRONT(seq + 2);
+}
+
+/****************************************************************
+*  Finish writing a table:  flip the buffers
+*/
+void table_write_end(t_mess_table *table)
+{
+  MESS_BARRIER();
+  ATOMIC_INCREMENT(&table->seq);
+
+  // The published name follows the front list
+  if (table->pub) { mess_publish(table->mess + TABLE_FRONT((t_uint32)table->seq), table->pub); }
+}
+
+/****************************************************************
+*  Cancel a write, without flipping the buffers
+*/
+void table_write_cancel(t_mess_table *table)
+{
+  MESS_BARRIER();
+  ATOMIC_DECREMENT(&table->seq);
+}
+
+/****************************************************************
+*  Initialize an inbox
+*/
+void inbox_init(t_mess_inbox *inbox)
+{
+  for (t_int32 i = 0; i < 3; i++) { mess_init(inbox->slots + i); }
+  inbox->back = 0;
+  inbox->middle = 1;
+  inbox->front = 2;
+}
+
+/****************************************************************
+*  Allocate the lists of an inbox
+*/
+t_bool inbox_realloc(t_mess_inbox *inbox, t_mess_int len_max, void *x)
+{
+  inbox_clear(inbox);
+  for (t_int32 i = 0; i < 3; i++) { mess_realloc(inbox->slots + i, len_max, x); }
+
+  for (t_int32 i = 0; i < 3; i++) {
+    if (MESS_IS_NULL(inbox->slots + i)) { inbox_clear(inbox); return false; }
+  }
+  return true;
+}
+
+/****************************************************************
+*  Free the lists of an inbox
+*/
+void inbox_clear(t_mess_inbox *inbox)
+{
+  for (t_int32 i = 0; i < 3; i++) { mess_clear(inbox->slots + i); }
+  inbox->back = 0;
+  inbox->middle = 1;
+  inbox->front = 2;
+}
+
+/****************************************************************
+*  Post a list to an inbox:  get the list to set
+*/
+t_mess inbox_write_begin(t_mess_inbox *inbox)
+{
+  return inbox->slots + inbox->back;
+}
+
+/****************************************************************
+*  Post a list to an inbox:  exchange the back and middle slots
+*/
+void inbox_write_end(t_mess_inbox *inbox)
+{
+  t_int32 middle;
+
+  MESS_BARRIER();
+  do { middle = inbox->middle; }
+  while (!ATOMIC_COMPARE_SWAP32(middle, inbox->back | INBOX_NEW, &inbox->middle));
+
+  inbox->back = middle & ~INBOX_NEW;
+}
+
+/****************************************************************
+*  Take the newest list from an inbox, if any
+*/
+t_bool inbox_take(t_mess_inbox *inbox, t_mess dest)
+{
+  t_int32 middle;
+  t_mess_struct tmp;
+
+  if (!(inbox->middle & INBOX_NEW)) { return false; }
+
+  // Exchange the front and middle slots
+  do { middle = inbox->middle; }
+  while (!ATOMIC_COMPARE_SWAP32(middle, inbox->front, &inbox->middle));
+  MESS_BARRIER();
+
+  inbox->front = middle & ~INBOX_NEW;
+
+  // Swap the newest list with the destination
+  tmp = *dest;
+  *dest = inbox->slots[inbox->front];
+  inbox->slots[inbox->front] = tmp;
+
+  return true;
+}
+
+/****************************************************************
+*  Initialize a worker
+*/
+void worker_init(t_mess_worker *w)
+{
+  w->thread = NULL;
+  w->mutex = NULL;
+  w->cond = NULL;
+  w->qelem = NULL;
+  w->x = NULL;
+  w->pending = false;
+  w->running = false;
+  w->ready = false;
+  w->quit = false;
+}
+
+/****************************************************************
+*  Thread function of a worker
+*/
+static void *worker_proc(t_mess_worker *w)
+{
+  systhread_mutex_lock(w->mutex);
+
+  while (true) {
+    while (!w->pending && !w->quit) { systhread_cond_wait(w->cond, w->mutex); }
+    if (w->quit) { break; }
+
+    // Take the inputs and process them without the lock
+    w->pending = false;
+    w->running = true;
+    w->take(w->x);
+    systhread_mutex_unlock(w->mutex);
+
+    w->run(w->x);
+
+    // Give the result, unless a newer request superseded it
+    systhread_mutex_lock(w->mutex);
+    w->running = false;
+    if (!w->pending) {
+      w->give(w->x);
+      w->ready = true;
+      qelem_set(w->qelem);
+    }
+  }
+
+  systhread_mutex_unlock(w->mutex);
+  systhread_exit(0);
+  return NULL;
+}
+
+/****************************************************************
+*  Start a worker
+*/
+t_bool worker_start(t_mess_worker *w, void *x, method take, method run, method give, method deliver)
+{
+  if (w->thread) { return true; }
+
+  w->x = x;
+  w->take = take;
+  w->run = run;
+  w->give = give;
+  w->pending = false;
+  w->running = false;
+  w->ready = false;
+  w->quit = false;
+
+  systhread_mutex_new(&w->mutex, 0);
+  systhread_cond_new(&w->cond, 0);
+  w->qelem = qelem_new(x, deliver);
+
+  if (!w->mutex || !w->cond || !w->qelem
+    || systhread_create((method)worker_proc, w, 0, 0, 0, &w->thread)) {
+    w->thread = NULL;
+    worker_stop(w);
+    return false;
+  }
+
+  return true;
+}
+
+/****************************************************************
+*  Stop a worker, waiting for the running request
+*/
+void worker_stop(t_mess_worker *w)
+{
+  unsigned int ret;
+
+  if (w->thread) {
+    systhread_mutex_lock(w->mutex);
+    w->quit = true;
+    systhread_cond_signal(w->cond);
+    systhread_mutex_unlock(w->mutex);
+    systhread_join(w->thread, &ret);
+  }
+
+  if (w->qelem) { qelem_free(w->qelem); }
+  if (w->cond) { systhread_cond_free(w->cond); }
+  if (w->mutex) { systhread_mutex_free(w->mutex); }
+  worker_init(w);
+}
+
+/****************************************************************
+*  Lock and unlock the inputs and results shared with the worker
+*/
+void worker_lock(t_mess_worker *w)
+{
+  systhread_mutex_lock(w->mutex);
+}
+
+void worker_unlock(t_mess_worker *w)
+{
+  systhread_mutex_unlock(w->mutex);
+}
+
+/****************************************************************
+*  Test if a request is pending or running, with the lock
+*/
+t_bool worker_busy(t_mess_worker *w)
+{
+  return w->pending || w->running;
+}
+
+/****************************************************************
+*  Request the processing of the inputs set, with the lock
+*/
+t_bool worker_request(t_mess_worker *w, char drop)
+{
+  if ((drop == WORKER_DROP_NEWER) && worker_busy(w)) { return false; }
+
+  w->pending = true;
+  systhread_cond_signal(w->cond);
+  return true;
+}
+
+/****************************************************************
+*  Take the result to deliver, with the lock
+*/
+t_bool worker_result(t_mess_worker *w)
+{
+  if (!w->ready) { return false; }
+
+  w->ready = false;
+  return true;
+}
+
+/****************************************************************
+*  Initialize a slicer
+*/
+void slicer_init(t_mess_slicer *s)
+{
+  s->clock = NULL;
+  s->x = NULL;
+  s->step = NULL;
+  s->done = NULL;
+  s->pos = 0;
+  s->end = 0;
+  s->chunk = SLICER_CHUNK_MIN;
+  s->budget = 0;
+  s->active = false;
+}
+
+/****************************************************************
+*  Clock function of a slicer:  process the next slice
+*/
+static void slicer_tick(t_mess_slicer *s)
+{
+  slicer_run(s);
+}
+
+/****************************************************************
+*  Set the functions of a slicer and create its clock
+*/
+t_bool slicer_setup(t_mess_slicer *s, void *x, method step, method done)
+{
+  s->x = x;
+  s->step = step;
+  s->done = done;
+  if (!s->clock) { s->clock = clock_new(s, (method)slicer_tick); }
+  return (s->clock != NULL);
+}
+
+/****************************************************************
+*  Free the clock of a slicer
+*/
+void slicer_free(t_mess_slicer *s)
+{
+  slicer_cancel(s);
+  if (s->clock) { object_free(s->clock); }
+  s->clock = NULL;
+}
+
+/****************************************************************
+*  Start processing a range, or restart if already active
+*/
+void slicer_start(t_mess_slicer *s, t_mess_int end, t_mess_int budget)
+{
+  slicer_cancel(s);
+
+  s->pos = 0;
+  s->end = end;
+  s->budget = budget / 1000.0;
+  s->active = true;
+  slicer_run(s);
+}
+
+/****************************************************************
+*  Cancel the processing
+*/
+void slicer_cancel(t_mess_slicer *s)
+{
+  if (s->clock) { clock_unset(s->clock); }
+  s->active = false;
+}
+
+/****************************************************************
+*  Process chunks until the budget is spent, then continue at the next tick
+*
+*  The chunk size is adapted to take about an eighth of the budget,
+*  so that the time is measured often enough without being measured for each element.
+*/
+void slicer_run(t_mess_slicer *s)
+{
+  t_mess_int beg = s->pos;
+  t_mess_int cnt;
+  double time = systimer_gettime();
+  double elapsed = 0;
+
+  while (s->active && (s->pos < s->end)) {
+    cnt = MIN(s->chunk, s->end - s->pos);
+    s->step(s->x, s->pos, s->pos + cnt);
+    s->pos += cnt;
+    if ((elapsed = systimer_gettime() - time) >= s->budget) { break; }
+  }
+
+  // Cancelled by the step function
+  if (!s->active) { return; }
+
+  if (elapsed > 0) {
+    s->chunk = (t_mess_int)CLAMP((s->pos - beg) * (s->budget / 8) / elapsed, SLICER_CHUNK_MIN, SLICER_CHUNK_MAX); }
+
+  if (s->pos < s->end) { clock_fdelay(s->clock, 0); }
+  else {
+    s->active = false;
+    s->done(s->x);
+  }
+}
+
+/****************************************************************
+*  Thread pool, common to the objects of the external
+*/
+#define POOL_IDLE     0
+#define POOL_STARTING 1
+#define POOL_READY    2
+
+static struct
+{
+  t_int32           threads;                    // number of deques, one per thread
+  t_systhread       thread[POOL_THREADS_MAX];   // NULL if the thread could not be created
+  t_pool_deque      deques[POOL_THREADS_MAX];
+  t_systhread_mutex mutex;                      // to sleep and wake the threads
+  t_systhread_cond  cond;
+  t_systhread_cond  done;                       // to wake the callers when a range is complete
+  t_int32_atomic    queued;                     // number of tasks in the deques
+  t_int32_atomic    next;                       // deque to receive the next range
+  t_bool            quit;
+} pool;
+
+static t_int32_atomic pool_state = POOL_IDLE;
+
+/****************************************************************
+*  Get the number of cores
+*/
+static t_int32 pool_numcores(void)
+{
+#if defined(WIN_VERSION)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (t_int32)info.dwNumberOfProcessors;
+#else
+  return (t_int32)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+/****************************************************************
+*  Push a task to the back of a deque
+*
+*  Returns false if the deque is full.
+*/
+static t_bool pool_push(t_pool_deque *d, t_pool_task *task)
+{
+  t_bool pushed = false;
+
+  systhread_mutex_lock(d->mutex);
+  if (d->tail - d->head < POOL_DEQUE_SIZE) {
+    d->tasks[d->tail % POOL_DEQUE_SIZE] = *task;
+    d->tail++;
+    pushed = true;
+  }
+  systhread_mutex_unlock(d->mutex);
+
+  return pushed;
+}
+
+/****************************************************************
+*  Take a task from the back of a deque, or steal it from the front
+*
+*  Returns false if the deque is empty.
+*/
+static t_bool pool_take(t_pool_deque *d, t_pool_task *task, t_bool steal)
+{
+  t_bool taken = false;
+
+  systhread_mutex_lock(d->mutex);
+  if (d->tail > d->head) {
+    if (steal) { *task = d->tasks[d->head % POOL_DEQUE_SIZE]; d->head++; }
+    else { d->tail--; *task = d->tasks[d->tail % POOL_DEQUE_SIZE]; }
+    if (d->tail == d->head) { d->head = d->tail = 0; }
+    taken = true;
+  }
+  systhread_mutex_unlock(d->mutex);
+
+  if (taken) { ATOMIC_DECREMENT(&pool.queued); }
+  return taken;
+}
+
+/****************************************************************
+*  Find a task:  from the own deque of a thread first, then from the others
+*
+*  The calling threads have no deque of their own, and use -1.
+*/
+static t_bool pool_find(t_int32 self, t_pool_task *task)
+{
+  t_int32 first = (self >= 0) ? self : (t_int32)((t_uint32)pool.next % pool.threads);
+
+  if ((self >= 0) && pool_take(pool.deques + self, task, false)) { return true; }
+
+  for (t_int32 i = 0; i < pool.threads; i++) {
+    t_int32 k = (first + i) % pool.threads;
+    if ((k != self) && pool_take(pool.deques + k, task, true)) { return true; }
+  }
+
+  return false;
+}
+
+/****************************************************************
+*  Process a task and count it as complete
+*
+*  The last task of a range wakes the callers waiting for their range.
+*/
+static void pool_run(t_pool_task *task)
+{
+  task->fn(task->data, task->beg, task->end);
+  if (ATOMIC_DECREMENT(task->left) > 0) { return; }
+
+  systhread_mutex_lock(pool.mutex);
+  systhread_cond_broadcast(pool.done);
+  systhread_mutex_unlock(pool.mutex);
+}
+
+/****************************************************************
+*  Thread procedure:  process tasks, and sleep while there are none
+*/
+static void *pool_proc(void *arg)
+{
+  t_int32 self = (t_int32)(t_ptr_int)arg;
+  t_pool_task task;
+  t_bool quit = false;
+
+  while (!quit) {
+    if (pool_find(self, &task)) { pool_run(&task); continue; }
+
+    systhread_mutex_lock(pool.mutex);
+    while ((pool.queued <= 0) && !pool.quit) { systhread_cond_wait(pool.cond, pool.mutex); }
+    quit = pool.quit;
+    systhread_mutex_unlock(pool.mutex);
+  }
+
+  systhread_exit(0);
+  return NULL;
+}
+
+/****************************************************************
+*  Stop the threads, called when Max quits
+*/
+static void pool_stop(void)
+{
+  unsigned int ret;
+
+  systhread_mutex_lock(pool.mutex);
+  pool.quit = true;
+  systhread_cond_broadcast(pool.cond);
+  systhread_mutex_unlock(pool.mutex);
+
+  for (t_int32 i = 0; i < pool.threads; i++) {
+    if (pool.thread[i]) { systhread_join(pool.thread[i], &ret); }
+    systhread_mutex_free(pool.deques[i].mutex);
+  }
+
+  systhread_cond_free(pool.done);
+  systhread_cond_free(pool.cond);
+  systhread_mutex_free(pool.mutex);
+  pool.threads = 0;
+}
+
+/****************************************************************
+*  Start the threads on first use
+*
+*  One thread less than the number of cores is created, as the calling thread
+*  takes part in the processing.
+*  Returns false if there are no threads, or if they are being started
+*  by another thread.
+*/
+static t_bool pool_start(void)
+{
+  if (pool_state == POOL_READY) { MESS_BARRIER(); return (pool.threads > 0); }
+  if (!ATOMIC_COMPARE_SWAP32(POOL_IDLE, POOL_STARTING, &pool_state)) { return false; }
+
+  pool.threads = CLAMP(pool_numcores() - 1, 0, POOL_THREADS_MAX);
+  pool.queued = 0;
+  pool.next = 0;
+  pool.quit = false;
+  systhread_mutex_new(&pool.mutex, 0);
+  systhread_cond_new(&pool.cond, 0);
+  systhread_cond_new(&pool.done, 0);
+
+  if (!pool.mutex || !pool.cond || !pool.done) {
+    if (pool.done) { systhread_cond_free(pool.done); }
+    if (pool.cond) { systhread_cond_free(pool.cond); }
+    if (pool.mutex) { systhread_mutex_free(pool.mutex); }
+    pool.threads = 0;
+  }
+
+  // The deques are all set before the threads steal from them
+  for (t_int32 i = 0; i < pool.threads; i++) {
+    systhread_mutex_new(&pool.deques[i].mutex, 0);
+    pool.deques[i].head = 0;
+    pool.deques[i].tail = 0;
+  }
+
+  // The tasks of a thread that could not be created are stolen by the others
+  for (t_int32 i = 0; i < pool.threads; i++) {
+    if (systhread_create((method)pool_proc, (void *)(t_ptr_int)i, 0, 0, 0, pool.thread + i)) {
+      pool.thread[i] = NULL; }
+  }
+
+  if (pool.threads) { quittask_install((method)pool_stop, NULL); }
+
+  MESS_BARRIER();
+  pool_state = POOL_READY;
+  return (pool.threads > 0);
+}
+
+/****************************************************************
+*  Process a range, split across the threads if long enough
+*
+*  The tasks are dealt to the deques in turn, starting from a different deque
+*  for each range. The tasks that do not fit are processed by the calling thread,
+*  which then steals tasks while there are any. Once the deques are empty,
+*  the remaining tasks of the range are all running, and the calling thread
+*  sleeps until the last one completes.
+*/
+void pool_for(t_pool_fn fn, void *data, t_mess_int len)
+{
+  pool_for_min(fn, data, len, POOL_LEN_MIN);
+}
+
+void pool_for_min(t_pool_fn fn, void *data, t_mess_int len, t_mess_int len_min)
+{
+  if ((len < MAX(len_min, 2)) || !pool_start()) {
+    fn(data, 0, len);
+    return;
+  }
+
+  t_int32 cnt = (pool.threads + 1) * POOL_TASKS_THREAD;
+  t_mess_int chunk = (len + cnt - 1) / cnt;
+  t_int32 first = (t_int32)((t_uint32)ATOMIC_INCREMENT(&pool.next) % pool.threads);
+  t_int32_atomic left;
+  t_pool_task task;
+
+  // The number of tasks is recounted, as the last ones can be empty after rounding
+  cnt = (t_int32)((len + chunk - 1) / chunk);
+  left = cnt;
+  task.fn = fn;
+  task.data = data;
+  task.left = &left;
+
+  // Deal the tasks, keeping the first one for the calling thread
+  for (t_int32 i = 1; i < cnt; i++) {
+    task.beg = i * chunk;
+    task.end = MIN(task.beg + chunk, len);
+    ATOMIC_INCREMENT(&pool.queued);
+    if (!pool_push(pool.deques + (first + i) % pool.threads, &task)) {
+      ATOMIC_DECREMENT(&pool.queued);
+      pool_run(&task);
+    }
+  }
+
+  systhread_mutex_lock(pool.mutex);
+  systhread_cond_broadcast(pool.cond);
+  systhread_mutex_unlock(pool.mutex);
+
+  task.beg = 0;
+  task.end = MIN(chunk, len);
+  pool_run(&task);
+
+  // Steal tasks, possibly from other ranges, while the range is not complete
+  while ((left > 0) && pool_find(-1, &task)) { pool_run(&task); }
+
+  // ... then wait for the tasks still running
+  systhread_mutex_lock(pool.mutex);
+  while (left > 0) { systhread_cond_wait(pool.done, pool.mutex); }
+  systhread_mutex_unlock(pool.mutex);
+
+  MESS_BARRIER();
+}
+
+/****************************************************************
+*  Convert an atom to a compact word
+*
+*  Returns false if the atom cannot be stored.
+*/
+t_bool word_from_atom(t_mess_word *word, t_atom *atom)
+{
+  t_atom_long n;
+  t_mess_word raw;
+  double f;
+
+  switch (atom_gettype(atom)) {
+  case A_LONG:
+    n = atom_getlong(atom);
+    if ((n < WORD_INT_MIN) || (n > WORD_INT_MAX)) { return false; }
+    raw = WORD_TAG_INT | ((t_mess_word)n & WORD_PAYLOAD);
+    break;
+
+  case A_FLOAT:
+    f = atom_getfloat(atom);
+    if (f != f) { raw = WORD_NAN; }
+    else { memcpy(&raw, &f, sizeof(double)); }
+    break;
+
+  case A_SYM:
+    raw = (t_mess_word)(t_ptr_uint)atom_getsym(atom);
+    if (raw & ~WORD_PAYLOAD) { return false; }
+    raw |= WORD_TAG_SYM;
+    break;
+
+  default:
+    return false;
+  }
+
+  *word = raw ^ WORD_TAG_INT;
+  return true;
+}
+
+/****************************************************************
+*  Initialize a compact message structure
+*/
+void compact_init(t_mess_compact *comp)
+{
+  comp->len_cur = 0;
+  comp->len_max = 0;
+  comp->sym     = sym_null;
+  comp->words   = NULL;
+  comp->offset  = 0;
+}
+
+/****************************************************************
+*  Allocate a compact message structure
+*
+*  The words are zero initialized by the allocator, as the int 0.
+*/
+void compact_realloc(t_mess_compact *comp, t_mess_int len_max, void *x)
+{
+  if (comp->words) { sysmem_freeptr(comp->words); }
+  compact_init(comp);
+
+  comp->words = (t_mess_word *)sysmem_newptrclear((long)(len_max * sizeof(t_mess_word)));
+  if (comp->words) {
+    comp->len_max = len_max;
+    comp->sym = sym_empty;
+  }
+  else { ERR("Allocation error. Try resetting maxlen."); }
+}
+
+/****************************************************************
+*  Free a compact message structure
+*/
+void compact_clear(t_mess_compact *comp)
+{
+  if (comp->words) { sysmem_freeptr(comp->words); }
+  compact_init(comp);
+}
+
+/****************************************************************
+*  Pack a message structure in a compact one
+*
+*  Returns false, with an empty compact structure, if an atom cannot be stored.
+*/
+t_bool compact_pack(t_mess_compact *comp, t_mess mess)
+{
+  comp->len_cur = 0;
+  comp->sym = sym_empty;
+  comp->offset = 0;
+  if (!comp->words || (mess->len_cur > comp->len_max)) { return false; }
+
+  for (t_mess_int i = 0; i < mess->len_cur; i++) {
+    if (!word_from_atom(comp->words + i, mess->list + i)) { return false; }
+  }
+
+  comp->len_cur = mess->len_cur;
+  comp->sym = mess->sym;
+  comp->offset = mess->offset;
+  return true;
+}
+
 /****************************************************************
 *  Set a message structure to empty
 */
 void mess_set_empty(t_mess mess)
 {
+  mess_unshare(mess);
   mess->len_cur = 0;
-  for (t_int32 i = 0; i < mess->len_max; i++) { atom_setlong(mess->list + i, 0); }
+  memset(mess->list, 0, (size_t)mess->len_used * sizeof(t_atom));
+  mess->len_used = 0;
 
   mess->offset = 0;
   mess->sym = sym_empty;
@@ -100,6 +1216,8 @@ void mess_set(t_mess mess, t_symbol *sym, t_mess_int argc, t_atom *argv, char of
   void *x, char warn)
 {
   ASSERT_MESS(mess);
+  mess_unshare(mess);
+  ASSERT_MESS(mess);
 
   // Store the leading symbol in the first atom
   // It will be overwritten if offset is 0
@@ -115,16 +1233,44 @@ void mess_set(t_mess mess, t_symbol *sym, t_mess_int argc, t_atom *argv, char of
   mess->len_cur = argc + offset;
   mess->sym     = sym;
   mess->offset  = offset;
+  mess->len_used = MAX(mess->len_used, mess->len_cur);
   ATOMS_COPY(mess->list + offset, argv, argc);
 }
 
+/****************************************************************
+*  Fill a list with copies of an atom, split across the threads if long
+*/
+typedef struct _atoms_fill
+{
+  t_atom *list;
+  t_atom  atom;
+} t_atoms_fill;
+
+static void atoms_fill_range(t_atoms_fill *fill, t_mess_int beg, t_mess_int end)
+{
+  for (t_mess_int i = beg; i < end; i++) { fill->list[i] = fill->atom; }
+}
+
+static void atoms_fill(t_atom *list, t_atom *atom, t_mess_int len)
+{
+  t_atoms_fill fill;
+
+  fill.list = list;
+  fill.atom = *atom;
+  pool_for((t_pool_fn)atoms_fill_range, &fill, len);
+}
+
 /****************************************************************
 *  Fill a message structure with an int value
 */
 void mess_fill_int(t_mess mess, t_atom_long val, t_mess_int len)
 {
+  mess_unshare(mess);
   mess->len_cur = len;
-  for (t_int32 i = 0; i < mess->len_max; i++) { atom_setlong(mess->list + i, val); }
+  t_atom atom;
+  atom_setlong(&atom, val);
+  atoms_fill(mess->list, &atom, mess->len_max);
+  mess->len_used = mess->len_max;
 
   mess->offset = 0;
   switch (len) {
@@ -139,8 +1285,12 @@ void mess_fill_int(t_mess mess, t_atom_long val, t_mess_int len)
 */
 void mess_fill_float(t_mess mess, t_atom_float val, t_mess_int len)
 {
+  mess_unshare(mess);
   mess->len_cur = len;
-  for (t_int32 i = 0; i < mess->len_max; i++) { atom_setfloat(mess->list + i, val); }
+  t_atom atom;
+  atom_setfloat(&atom, val);
+  atoms_fill(mess->list, &atom, mess->len_max);
+  mess->len_used = mess->len_max;
 
   mess->offset = 0;
   switch (len) {
@@ -155,8 +1305,12 @@ void mess_fill_float(t_mess mess, t_atom_float val, t_mess_int len)
 */
 void mess_fill_sym(t_mess mess, t_symbol *sym, t_mess_int len)
 {
+  mess_unshare(mess);
   mess->len_cur = len;
-  for (t_int32 i = 0; i < mess->len_max; i++) { atom_setsym(mess->list + i, sym); }
+  t_atom atom;
+  atom_setsym(&atom, sym);
+  atoms_fill(mess->list, &atom, mess->len_max);
+  mess->len_used = mess->len_max;
 
   switch (len) {
   case 0:  mess->offset = 0; mess->sym = sym_empty; break;
@@ -169,8 +1323,10 @@ void mess_fill_sym(t_mess mess, t_symbol *sym, t_mess_int len)
 */
 void mess_fill_atom(t_mess mess, t_atom *atom, t_mess_int len)
 {
+  mess_unshare(mess);
   mess->len_cur = len;
-  for (t_int32 i = 0; i < mess->len_max; i++) { mess->list[i] = *atom; }
+  atoms_fill(mess->list, atom, mess->len_max);
+  mess->len_used = mess->len_max;
   mess_set_type(mess);
 }
 
@@ -202,6 +1358,87 @@ void mess_set_type(t_mess mess)
   }
 }
 
+/****************************************************************
+*  Append the content of a message structure to another one
+*
+*  The appended atoms are truncated if necessary.
+*  Use mess_set_type() after to set the type of the destination.
+*/
+void mess_cat(t_mess dest, t_mess src, void *x, char warn)
+{
+  ASSERT_MESS(dest);
+  mess_unshare(dest);
+  ASSERT_MESS(dest);
+
+  t_mess_int cnt = src->len_cur;
+
+  // Truncate the appended atoms if necessary
+  if (cnt > dest->len_max - dest->len_cur) {
+    WARN(warn, "Message truncated from length %i to %i.", dest->len_cur + cnt, dest->len_max);
+    cnt = dest->len_max - dest->len_cur;
+  }
+
+  ATOMS_COPY(dest->list + dest->len_cur, src->list, cnt);
+  dest->len_cur += cnt;
+  dest->len_used = MAX(dest->len_used, dest->len_cur);
+}
+
+/****************************************************************
+*  Get the stride and number of frames from a frames message
+*
+*  The message is expected as:  frames <stride> <atoms>
+*  The stride is removed from the atoms.
+*  Returns the number of frames, or 0 if the message is invalid.
+*/
+t_mess_int frames_parse(long *argc, t_atom **argv, t_mess_int *stride, void *x, char warn)
+{
+  // Test the stride
+  if ((*argc < 1) || ((atom_gettype(*argv) != A_LONG) && (atom_gettype(*argv) != A_FLOAT))
+    || (atom_getlong(*argv) < 1)) {
+    ERR("frames:  Invalid stride - Expected: frames <int >= 1> <atoms>");
+    return 0;
+  }
+
+  *stride = (t_mess_int)atom_getlong(*argv);
+  (*argc)--;
+  (*argv)++;
+
+  // Incomplete trailing frames are ignored
+  if (*argc % *stride) {
+    WARN(warn, "frames:  The last %i atoms do not form a complete frame and are ignored.",
+      (t_mess_int)(*argc % *stride));
+  }
+
+  return (t_mess_int)(*argc / *stride);
+}
+
+/****************************************************************
+*  Make room for the output of a batch of frames
+*
+*  The list is only replaced once the new one is allocated.
+*/
+t_bool frames_reserve(t_mess mess, t_mess_int frames, t_mess_int len, char policy, void *x, char warn)
+{
+  t_int64 total = (t_int64)frames * len;
+  t_mess_struct grown[1];
+
+  if (total <= mess->len_max) { return true; }
+
+  if (total > FRAMES_LEN_MAX) {
+    WARN(warn, "frames:  The output of %i frames of length %i exceeds %i atoms - Batch ignored.",
+      frames, len, FRAMES_LEN_MAX);
+    return false;
+  }
+
+  mess_init(grown);
+  mess_realloc_policy(grown, (t_mess_int)total, policy, x);
+  if (MESS_IS_NULL(grown)) { return false; }
+
+  mess_clear(mess);
+  *mess = *grown;
+  return true;
+}
+
 /****************************************************************
 *  Post the content of a message structure in the console
 */
@@ -227,3 +1464,32 @@ void mess_post(t_mess mess, const char *name, void *x)
   POST(dstr->cstr);
   dstr_free(&dstr);
 }
+
+/****************************************************************
+*  Count the bits set in a word
+*/
+t_int32 bits_popcount(t_uint64 word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (t_int32)__builtin_popcountll(word);
+#else
+  word = word - ((word >> 1) & 0x5555555555555555ULL);
+  word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+  word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (t_int32)((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/****************************************************************
+*  Count the trailing zero bits in a word
+*
+*  The word is expected to be non zero.
+*/
+t_int32 bits_ctz(t_uint64 word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (t_int32)__builtin_ctzll(word);
+#else
+  return bits_popcount((word & (~word + 1)) - 1);
+#endif
+}
@@ -5,6 +5,8 @@
 *  Header files
 */
 #include "ext.h"
+#include "ext_atomic.h"
+#include "ext_systhread.h"
 #include "dstring.h"
 
 /****************************************************************
@@ -24,6 +26,9 @@ struct _mess_struct
   t_symbol  *sym;
   t_atom    *list;
   char       offset;
+  char       alloc;     // how the list was allocated:  see MESS_ALLOC_DEFAULT
+  t_int32_atomic *refs; // reference count if the list is shared, NULL otherwise
+  t_mess_int len_used;  // the atoms from len_used on are the int 0, see mess_zpad()
 };
 
 /****************************************************************
@@ -33,19 +38,68 @@ struct _mess_struct
 
 #define ASSERT_MESS(mess) if (MESS_IS_NULL(mess)) { return; }
 
-#define ASSERT_ALLOC if (!x->maxlen) { ERR("Previous allocation error. Try resetting maxlen."); return; }
+/****************************************************************
+*  Lazy allocation
+*
+*  The maxlen setters only store the length and set x->alloc_pending.
+*  The buffers are allocated on first use by ASSERT_ALLOC, which calls
+*  the function that each external defines as ALLOC_FUNCTION.
+*  It returns MAX_ERR_NONE on success, otherwise sets maxlen to 0.
+*/
+#define ASSERT_ALLOC \
+  if (!x->maxlen || (x->alloc_pending && (ALLOC_FUNCTION(x) != MAX_ERR_NONE))) { \
+    ERR("Previous allocation error. Try resetting maxlen."); return; }
+
+/****************************************************************
+*  Get the type of an atom from a message structure
+*
+*  The lists are allocated zero initialized, and the atoms that were never
+*  written are all-zero (A_NOTHING). They are read as the int 0.
+*/
+#define ATOM_TYPE(atom) ((atom_gettype(atom) == A_NOTHING) ? A_LONG : atom_gettype(atom))
+
+/****************************************************************
+*  Memory barrier, for the data shared between threads without locks
+*/
+#if defined(WIN_VERSION)
+#define MESS_BARRIER() MemoryBarrier()
+#else
+#define MESS_BARRIER() __sync_synchronize()
+#endif
 
 #define ATOMS_COPY(dest, src, cnt) \
   sysmem_copyptr((src), (dest), (long)(sizeof(t_atom) * (cnt)))
 
-#define TRACE(str, ...)      //object_post ((t_object *)x, "TRACE:  " str, __VA_ARGS__)
-#define POST(str, ...)       object_post ((t_object *)x, (str), __VA_ARGS__)
-#define WARN(warn, str, ...) if (warn) { object_warn ((t_object *)x, (str), __VA_ARGS__); }
-#define ERR(str, ...)        object_error((t_object *)x, (str), __VA_ARGS__)
+#define TRACE(str, ...)      //object_post ((t_object *)x, "TRACE:  " str, ##__VA_ARGS__)
+#define POST(str, ...)       object_post ((t_object *)x, (str), ##__VA_ARGS__)
+#define WARN(warn, str, ...) if (warn) { object_warn ((t_object *)x, (str), ##__VA_ARGS__); }
+#define ERR(str, ...)        object_error((t_object *)x, (str), ##__VA_ARGS__)
 
 //#define DEBUG_ALLOC(ptr) if ((float)rand() / RAND_MAX <= 0.1) { sysmem_freeptr(ptr); (ptr) = NULL; }
 
+/****************************************************************
+*  Allocation policies
+*
+*  With MESS_ALLOC_LARGE, lists of at least MESS_LARGE_MIN bytes are allocated
+*  on large pages when the system allows it, and touched once on allocation
+*  so that their pages are placed on the memory node of the allocating thread.
+*/
+#define MESS_ALLOC_DEFAULT 0
+#define MESS_ALLOC_LARGE   1
+#define MESS_LARGE_MIN     (2 * 1024 * 1024)
+
 #define MAXLEN_DEF 256
+#define INLETS_MAX 32
+#define FRAMES_LEN_MAX (1 << 22)   // maximum length of the output of a batch of frames
+
+/****************************************************************
+*  Bitsets
+*
+*  Packed in 64 bit words, position i being bit (i % 64) of word (i / 64).
+*/
+#define BITS_WORDS(len) (((len) + 63) / 64)
+#define BITS_TEST(bits, i) (((bits)[(i) >> 6] >> ((i) & 63)) & 1)
+#define BITS_SET(bits, i)  ((bits)[(i) >> 6] |= (t_uint64)1 << ((i) & 63))
 
 /****************************************************************
 *  Function declarations
@@ -68,17 +122,446 @@ void mess_init       (t_mess mess);
 /****************************************************************
 *  Allocate the members in a message structure
 *
+*  The list is zero initialized by the allocator:  see ATOM_TYPE().
 *  Can be used repeatedly.
 *  It is assumed that mess_init() was called first.
 *  Use mess_clear() to free the allocated memory.
 */
 void mess_realloc    (t_mess mess, t_mess_int len_max, void *x);
 
+/****************************************************************
+*  Allocate the members in a message structure, with an allocation policy
+*
+*  Same as mess_realloc(), with MESS_ALLOC_DEFAULT or MESS_ALLOC_LARGE.
+*/
+void mess_realloc_policy (t_mess mess, t_mess_int len_max, char policy, void *x);
+
+/****************************************************************
+*  Move the list of a message structure to another allocation policy
+*
+*  Unlike mess_realloc_policy(), the contents are kept.
+*  Returns false if the new list could not be allocated, the structure being unchanged.
+*/
+t_bool mess_move_policy (t_mess mess, char policy, void *x);
+
 /****************************************************************
 *  Free the members in a message structure
 */
 void mess_clear      (t_mess mess);
 
+/****************************************************************
+*  Share the list of a message structure with another one
+*
+*  The list is not copied but reference counted, and each message structure
+*  copies it on its next modification (copy-on-write).
+*  Both structures should have the same maximum length.
+*  Returns false if the list could not be shared.
+*/
+t_bool mess_share    (t_mess dest, t_mess src, void *x);
+
+/****************************************************************
+*  Make the list of a message structure private before modifying it
+*
+*  Called by the functions that modify a message structure.
+*  To be called before writing directly to the list of a structure that can be shared.
+*/
+void mess_unshare    (t_mess mess);
+
+/****************************************************************
+*  Publish a message structure under a name, for other objects to share it
+*
+*  The names are common to the objects of one external.
+*  Use mess_unpublish() before freeing the structure.
+*/
+void mess_publish    (t_mess mess, t_symbol *name);
+
+/****************************************************************
+*  Remove a message structure from the published ones
+*/
+void mess_unpublish  (t_mess mess);
+
+/****************************************************************
+*  Get the message structure published under a name, or NULL
+*/
+t_mess mess_published (t_symbol *name);
+
+/****************************************************************
+*  Named tables
+*
+*  A stored list bound to a name, common to the objects of one external,
+*  with an index holding data derived from the list by the objects.
+*
+*  The list is double buffered and protected by a sequence counter, so that
+*  it can be written from the main thread while being read from the scheduler
+*  thread, without locks on the reading side:
+*    - the writer modifies the back list and its index, then flips the buffers,
+*    - the reader reads the front list and its index, then retries if a
+*      writer started to modify them in the meantime.
+*  The index is built by the writer, once for all the objects bound to the table.
+*/
+typedef struct _mess_table
+{
+  t_symbol       *name;
+  t_int32         refs;      // number of objects bound to the table
+  t_int32_atomic  seq;       // sequence counter:  odd while a write is in progress
+  t_mess_struct   mess[2];   // front and back lists
+  void           *index[2];  // allocated with sysmem_newptr(), NULL if none
+  t_symbol       *pub;       // name the front list is published under, or NULL
+} t_mess_table;
+
+/****************************************************************
+*  Initialize and free a table that is not bound to a name
+*
+*  table_clear() unpublishes the lists, and keeps the name for table_realloc().
+*/
+void table_init      (t_mess_table *table);
+void table_clear     (t_mess_table *table);
+
+/****************************************************************
+*  Allocate the lists of a table, with an allocation policy
+*
+*  Same as mess_realloc_policy(), for both buffers.
+*  The front list is published again if the table was published.
+*  Returns false if the lists could not be allocated.
+*/
+t_bool table_realloc (t_mess_table *table, t_mess_int len_max, char policy, void *x);
+
+/****************************************************************
+*  Bind to the table with a name, creating it if necessary
+*
+*  A new table is allocated with the maximum length given.
+*  Returns NULL if the table could not be allocated.
+*  Use table_unbind() to release it, the last object frees the table.
+*/
+t_mess_table *table_bind (t_symbol *name, t_mess_int len_max, void *x);
+void table_unbind    (t_mess_table *table);
+
+/****************************************************************
+*  Publish the front list of a table under a name, or unpublish it if NULL
+*
+*  The name follows the front list when the buffers are flipped.
+*/
+void table_publish   (t_mess_table *table, t_symbol *name);
+
+/****************************************************************
+*  Read a table
+*
+*    t_uint32 seq;
+*    do {
+*      seq = table_read_begin(table);
+*      ... read table->mess + TABLE_FRONT(seq) and table->index[TABLE_FRONT(seq)] ...
+*    } while (table_read_retry(table, seq));
+*
+*  Nothing should be output from the loop, since the reads can be repeated.
+*/
+#define TABLE_FRONT(seq) (((seq) >> 1) & 1)
+
+t_uint32 table_read_begin (t_mess_table *table);
+t_bool   table_read_retry (t_mess_table *table, t_uint32 seq);
+
+/****************************************************************
+*  Write a table
+*
+*  table_write_begin() returns the back buffer, which holds the list from
+*  the write before the last one and should be set entirely,
+*  and table_write_end() flips the buffers.
+*  While writing, the index of the back buffer is table->index[TABLE_BACK(table)].
+*  Writers from different threads wait for each other.
+*/
+#define TABLE_BACK(table) (TABLE_FRONT((t_uint32)(table)->seq + 1))
+
+t_mess   table_write_begin  (t_mess_table *table);
+void     table_write_end    (t_mess_table *table);
+
+/****************************************************************
+*  Cancel a write, without flipping the buffers
+*/
+void     table_write_cancel (t_mess_table *table);
+
+/****************************************************************
+*  Inboxes
+*
+*  Lists sent to a cold inlet from another thread, stored without locks and
+*  applied at the next action of the hot inlet. Only the newest list is applied.
+*
+*  Single producer and single consumer:  the three lists are exchanged through
+*  the middle slot, the producer writing the back one and the consumer taking
+*  the front one, so that neither ever waits nor drops the newest list.
+*/
+#define INBOX_NEW 4   // flag set in middle when the middle slot holds a new list
+
+typedef struct _mess_inbox
+{
+  t_mess_struct   slots[3];
+  t_int32_atomic  middle;  // index of the middle slot, with INBOX_NEW
+  t_int32         back;    // index of the slot written by the producer
+  t_int32         front;   // index of the slot taken by the consumer
+} t_mess_inbox;
+
+/****************************************************************
+*  Initialize, allocate and free an inbox
+*
+*  inbox_realloc() returns false if the lists could not be allocated.
+*/
+void   inbox_init    (t_mess_inbox *inbox);
+t_bool inbox_realloc (t_mess_inbox *inbox, t_mess_int len_max, void *x);
+void   inbox_clear   (t_mess_inbox *inbox);
+
+/****************************************************************
+*  Post a list to an inbox
+*
+*  inbox_write_begin() returns the list to set entirely,
+*  and inbox_write_end() makes it the newest one.
+*/
+t_mess inbox_write_begin (t_mess_inbox *inbox);
+void   inbox_write_end   (t_mess_inbox *inbox);
+
+/****************************************************************
+*  Take the newest list from an inbox, if any
+*
+*  The list is swapped with the message structure given, without copies.
+*  Both should have the same maximum length.
+*  Returns false if there was no new list.
+*/
+t_bool inbox_take    (t_mess_inbox *inbox, t_mess dest);
+
+/****************************************************************
+*  Workers
+*
+*  A background thread processing the requests of an object, one at a time,
+*  with the results delivered on the main thread by a qelem.
+*
+*  The object keeps its own copies of the inputs and outputs, and provides:
+*    take (x):     with the lock, take the inputs of the pending request
+*    run (x):      without the lock, process them on the worker thread
+*    give (x):     with the lock, give the result to be delivered
+*    deliver (x):  from the qelem, take the result with the lock and output it
+*
+*  With WORKER_DROP_OLDER, a new request replaces the pending one, and the
+*  result of the running one is dropped. With WORKER_DROP_NEWER, the requests
+*  made while the worker is busy are dropped.
+*/
+#define WORKER_DROP_OLDER 0
+#define WORKER_DROP_NEWER 1
+
+typedef struct _mess_worker
+{
+  t_systhread        thread;
+  t_systhread_mutex  mutex;
+  t_systhread_cond   cond;
+  void              *qelem;
+  void              *x;
+  method             take;
+  method             run;
+  method             give;
+  t_bool             pending;  // a request is waiting for the worker
+  t_bool             running;  // a request is being processed
+  t_bool             ready;    // a result is waiting to be delivered
+  t_bool             quit;
+} t_mess_worker;
+
+/****************************************************************
+*  Initialize, start and stop a worker
+*
+*  worker_start() is called on first use, and returns false if the thread
+*  could not be created. worker_stop() waits for the running request.
+*/
+void   worker_init    (t_mess_worker *w);
+t_bool worker_start   (t_mess_worker *w, void *x, method take, method run, method give, method deliver);
+void   worker_stop    (t_mess_worker *w);
+
+/****************************************************************
+*  Lock the inputs and results shared with the worker
+*/
+void   worker_lock    (t_mess_worker *w);
+void   worker_unlock  (t_mess_worker *w);
+
+/****************************************************************
+*  Test if a request is pending or running, with the lock
+*/
+t_bool worker_busy    (t_mess_worker *w);
+
+/****************************************************************
+*  Request the processing of the inputs set, with the lock
+*
+*  Returns false if the request is dropped by the policy.
+*/
+t_bool worker_request (t_mess_worker *w, char drop);
+
+/****************************************************************
+*  Take the result to deliver, with the lock
+*
+*  Returns false if there is none.
+*/
+t_bool worker_result  (t_mess_worker *w);
+
+/****************************************************************
+*  Slicers
+*
+*  Process a long range in chunks over consecutive scheduler ticks,
+*  spending at most a time budget per tick, and resuming where it left off.
+*
+*  The object provides:
+*    step (x, beg, end):  process the range [beg, end)
+*    done (x):            called once the whole range is processed
+*
+*  The first slice is processed on start, so that a short range completes at once.
+*  The step function can call slicer_cancel() to stop the processing.
+*/
+#define SLICER_CHUNK_MIN 64
+#define SLICER_CHUNK_MAX (1 << 20)
+
+typedef struct _mess_slicer
+{
+  t_clock   *clock;
+  void      *x;
+  method     step;
+  method     done;
+  t_mess_int pos;      // next element to process
+  t_mess_int end;
+  t_mess_int chunk;    // elements processed between two measures of the time
+  double     budget;   // time budget per tick in milliseconds
+  t_bool     active;
+} t_mess_slicer;
+
+/****************************************************************
+*  Initialize, set up and free a slicer
+*
+*  slicer_setup() returns false if the clock could not be created.
+*/
+void   slicer_init   (t_mess_slicer *s);
+t_bool slicer_setup  (t_mess_slicer *s, void *x, method step, method done);
+void   slicer_free   (t_mess_slicer *s);
+
+/****************************************************************
+*  Start processing the range [0, end), with a budget in microseconds per tick
+*
+*  Restarts from the beginning if the slicer was already active.
+*/
+void   slicer_start  (t_mess_slicer *s, t_mess_int end, t_mess_int budget);
+void   slicer_cancel (t_mess_slicer *s);
+void   slicer_run    (t_mess_slicer *s);
+
+/****************************************************************
+*  Thread pool
+*
+*  Worker threads shared by all the objects of an external, to split the
+*  processing of a long range across the cores.
+*
+*  The range is cut into tasks dealt to the deques of the threads.
+*  Each thread takes tasks from the back of its own deque, and steals from
+*  the front of the others once it runs out. The calling thread steals as well
+*  until all the tasks of its range are complete.
+*
+*  The threads are created on first use, and stopped when Max quits.
+*  Ranges shorter than POOL_LEN_MIN are processed serially by the calling thread,
+*  as they are when the threads could not be created.
+*/
+#define POOL_LEN_MIN      100000
+#define POOL_THREADS_MAX  64
+#define POOL_DEQUE_SIZE   256
+#define POOL_TASKS_THREAD 4       // tasks per thread for each range
+
+typedef void (*t_pool_fn)(void *data, t_mess_int beg, t_mess_int end);
+
+typedef struct _pool_task
+{
+  t_pool_fn       fn;
+  void           *data;
+  t_mess_int      beg;
+  t_mess_int      end;
+  t_int32_atomic *left;   // number of tasks of the range not yet complete
+} t_pool_task;
+
+typedef struct _pool_deque
+{
+  t_systhread_mutex mutex;
+  t_pool_task       tasks[POOL_DEQUE_SIZE];
+  t_mess_int        head;   // the tasks are in [head, tail), modulo the size
+  t_mess_int        tail;
+} t_pool_deque;
+
+/****************************************************************
+*  Process the range [0, len) by calling fn(data, beg, end) on subranges
+*
+*  Returns once the whole range is processed. The subranges can be processed
+*  concurrently, so fn should only write to the elements of its subrange.
+*  pool_for_min() sets the minimum length to split instead of POOL_LEN_MIN,
+*  for ranges of costly elements.
+*/
+void   pool_for      (t_pool_fn fn, void *data, t_mess_int len);
+void   pool_for_min  (t_pool_fn fn, void *data, t_mess_int len, t_mess_int len_min);
+
+/****************************************************************
+*  Compact words
+*
+*  An atom NaN-boxed in 8 bytes rather than the 16 bytes of a t_atom:
+*    - floats are stored as doubles, with all NaNs made the same
+*    - ints of up to 48 bits and symbols are stored in the payload of a NaN,
+*      tagged in the upper 16 bits
+*  The words are XORed with the int tag, so that the all-zero word is the int 0,
+*  as the zero initialized atoms are (see ATOM_TYPE).
+*  Other atoms, and ints that do not fit in 48 bits, cannot be stored.
+*/
+typedef t_uint64 t_mess_word;
+
+#define WORD_TAG_MASK  0xFFFF000000000000ULL
+#define WORD_TAG_INT   0xFFF9000000000000ULL
+#define WORD_TAG_SYM   0xFFFA000000000000ULL
+#define WORD_PAYLOAD   0x0000FFFFFFFFFFFFULL
+#define WORD_NAN       0x7FF8000000000000ULL
+#define WORD_INT_MAX   (((t_atom_long)1 << 47) - 1)
+#define WORD_INT_MIN   (-((t_atom_long)1 << 47))
+
+/****************************************************************
+*  Convert an atom to a compact word
+*
+*  Returns false if the atom cannot be stored.
+*/
+t_bool word_from_atom (t_mess_word *word, t_atom *atom);
+
+/****************************************************************
+*  Get the type and value of a compact word
+*
+*  The type is A_LONG, A_FLOAT or A_SYM, and the values are converted as by atom_get*().
+*/
+long        word_gettype  (t_mess_word word);
+t_atom_long word_getlong  (t_mess_word word);
+double      word_getfloat (t_mess_word word);
+t_symbol   *word_getsym   (t_mess_word word);
+
+/****************************************************************
+*  Compact message structure
+*
+*  A copy of a message structure in compact words, packed when the message is stored,
+*  to be read with word_get*() by loops that scan the whole message.
+*/
+typedef struct _mess_compact
+{
+  t_mess_int   len_cur;
+  t_mess_int   len_max;
+  t_symbol    *sym;
+  t_mess_word *words;
+  char         offset;
+} t_mess_compact;
+
+/****************************************************************
+*  Initialize, allocate and free a compact message structure
+*
+*  Same as for a message structure. The words are zero initialized, as the int 0.
+*/
+void   compact_init    (t_mess_compact *comp);
+void   compact_realloc (t_mess_compact *comp, t_mess_int len_max, void *x);
+void   compact_clear   (t_mess_compact *comp);
+
+/****************************************************************
+*  Pack a message structure in a compact one
+*
+*  Returns false if an atom cannot be stored, or if the message is too long.
+*  The compact structure is then empty.
+*/
+t_bool compact_pack    (t_mess_compact *comp, t_mess mess);
+
 /****************************************************************
 *  Set a message structure to empty
 */
@@ -147,6 +630,14 @@ void mess_set_type   (t_mess mess);
 */
 void mess_zpad       (t_mess mess);
 
+/****************************************************************
+*  Append the content of a message structure to another one
+*
+*  The appended atoms are truncated if necessary.
+*  Use mess_set_type() after to set the type of the destination.
+*/
+void mess_cat        (t_mess dest, t_mess src, void *x, char warn);
+
 /****************************************************************
 *  Output the content of a message structure through an outlet
 */
@@ -157,6 +648,36 @@ void mess_outlet     (t_mess mess, void *outl);
 */
 void mess_post       (t_mess mess, const char *name, void *x);
 
+/****************************************************************
+*  Get the stride and number of frames from a frames message
+*
+*  The message is expected as:  frames <stride> <atoms>
+*  The stride is removed from the atoms.
+*  Returns the number of frames, or 0 if the message is invalid.
+*/
+t_mess_int frames_parse (long *argc, t_atom **argv, t_mess_int *stride, void *x, char warn);
+
+/****************************************************************
+*  Make room for the output of a batch of frames
+*
+*  The message structure is reallocated if it is shorter than frames * len,
+*  up to FRAMES_LEN_MAX atoms, and its contents are not kept.
+*  Returns false, with a single warning, if the batch should be rejected.
+*/
+t_bool frames_reserve (t_mess mess, t_mess_int frames, t_mess_int len, char policy, void *x, char warn);
+
+/****************************************************************
+*  Count the bits set in a word
+*/
+t_int32 bits_popcount (t_uint64 word);
+
+/****************************************************************
+*  Count the trailing zero bits in a word
+*
+*  The word is expected to be non zero.
+*/
+t_int32 bits_ctz      (t_uint64 word);
+
 /****************************************************************
 *  Extern variables for frequently used symbols
 */
@@ -171,6 +692,14 @@ extern t_symbol *sym_null;
 *  Inline functions definitions
 */
 
+/****************************************************************
+*  Allocate the members in a message structure
+*/
+__inline void mess_realloc(t_mess mess, t_mess_int len_max, void *x)
+{
+  mess_realloc_policy(mess, len_max, MESS_ALLOC_DEFAULT, x);
+}
+
 /****************************************************************
 *  Set a message structure to hold an int
 */
@@ -205,10 +734,16 @@ __inline void mess_set_any(t_mess mess, t_symbol *sym, t_mess_int argc, t_atom *
 
 /****************************************************************
 *  Pad the remainder of a message structure with zeros
+*
+*  Only the atoms left by a longer list are zeroed, up to len_used.
+*  As for a zero initialized list, the zeroed atoms are read as the int 0 by ATOM_TYPE.
 */
 __inline void mess_zpad(t_mess mess)
 {
-  for (t_int32 i = mess->len_cur; i < mess->len_max; i++) { atom_setlong(mess->list + i, 0); }
+  mess_unshare(mess);
+  if (mess->len_used > mess->len_cur) {
+    memset(mess->list + mess->len_cur, 0, (size_t)(mess->len_used - mess->len_cur) * sizeof(t_atom)); }
+  mess->len_used = mess->len_cur;
 }
 
 /****************************************************************
@@ -221,4 +756,52 @@ __inline void mess_outlet(t_mess mess, void *outl)
   }
 }
 
+/****************************************************************
+*  Get the type of a compact word
+*/
+__inline long word_gettype(t_mess_word word)
+{
+  word ^= WORD_TAG_INT;
+  switch (word & WORD_TAG_MASK) {
+  case WORD_TAG_INT: return A_LONG;
+  case WORD_TAG_SYM: return A_SYM;
+  default:           return A_FLOAT;
+  }
+}
+
+/****************************************************************
+*  Get the value of a compact word as an int
+*/
+__inline t_atom_long word_getlong(t_mess_word word)
+{
+  switch (word_gettype(word)) {
+  case A_LONG:  return (t_atom_long)((t_int64)(word << 16) >> 16);   // sign extend the 48 bits
+  case A_FLOAT: return (t_atom_long)word_getfloat(word);
+  default:      return 0;
+  }
+}
+
+/****************************************************************
+*  Get the value of a compact word as a float
+*/
+__inline double word_getfloat(t_mess_word word)
+{
+  double f;
+
+  switch (word_gettype(word)) {
+  case A_LONG:  return (double)word_getlong(word);
+  case A_FLOAT: word ^= WORD_TAG_INT; memcpy(&f, &word, sizeof(double)); return f;
+  default:      return 0;
+  }
+}
+
+/****************************************************************
+*  Get the value of a compact word as a symbol
+*/
+__inline t_symbol *word_getsym(t_mess_word word)
+{
+  if (word_gettype(word) != A_SYM) { return gensym(""); }
+  return (t_symbol *)(t_ptr_uint)((word ^ WORD_TAG_INT) & WORD_PAYLOAD);
+}
+
 #endif
\ No newline at end of file
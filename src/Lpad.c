@@ -9,6 +9,9 @@
 *    - The external uses the new style Max object and attributes.
 *    - The arrays to store lists and messages are resizable.
 *    - Non int, float or list messages can be processed (starting with a symbol).
+*    - Batches of frames can be processed in one message:  frames <stride> <atoms>
+*    - With the window attribute, the inputs are appended to a sliding window
+*      of the output length, which is output in chronological order.
 */
 
 /****************************************************************
@@ -36,12 +39,27 @@ typedef struct _lpad
   t_mess_int i_pad_left;
   t_atom     i_pad_val[1];
 
-  // Output message
+  // Output messages
   t_mess_struct o_list[1];
+  t_mess_struct o_frames[1];
+
+  // Padding state:  if valid, the output list holds the padding value
+  // before i_pad_left and from pad_end to maxlen
+  t_bool     pad_valid;
+  t_mess_int pad_end;
+
+  // Ring buffer for the window mode, ring_pos being the position of the oldest atom
+  t_mess_struct ring[1];
+  t_mess_int    ring_pos;
+  t_mess_int    ring_len;   // 0 if the ring has to be reset
+
+  // Lazy allocation:  true until the lists are allocated on first use
+  t_bool alloc_pending;
 
   // Attributes
   t_mess_int maxlen;     // maximum list length
   char       warnings;   // report warnings or not
+  char       window;     // sliding window mode
 
 } t_lpad;
 
@@ -62,16 +80,25 @@ void  lpad_int      (t_lpad *x, t_atom_long n);
 void  lpad_float    (t_lpad *x, double f);
 void  lpad_list     (t_lpad *x, t_symbol *sym, long argc, t_atom *argv);
 void  lpad_anything (t_lpad *x, t_symbol *sym, long argc, t_atom *argv);
+void  lpad_frames   (t_lpad *x, t_symbol *sym, long argc, t_atom *argv);
 void  lpad_clear    (t_lpad *x);
 void  lpad_reset    (t_lpad *x);
 void  lpad_post     (t_lpad *x);
 
 void  lpad_defaults (t_lpad *x);
 void  lpad_action   (t_lpad *x, t_symbol *sym, long argc, t_atom *argv, char offset);
+void  lpad_window   (t_lpad *x, t_symbol *sym, long argc, t_atom *argv, char offset);
+void  lpad_ring_push (t_lpad *x, t_atom *argv, t_mess_int cnt);
 void  lpad_output   (t_lpad *x);
 
+t_max_err lpad_alloc      (t_lpad *x);
 t_max_err lpad_maxlen_set (t_lpad *x, void *attr, long argc, t_atom *argv);
 
+/****************************************************************
+*  Allocation function called by ASSERT_ALLOC
+*/
+#define ALLOC_FUNCTION lpad_alloc
+
 /****************************************************************
 *  Initialization
 */
@@ -94,6 +121,7 @@ void ext_main(void *r)
   class_addmethod(c, (method)lpad_float,    "float",     A_FLOAT, 0);
   class_addmethod(c, (method)lpad_list,     "list",      A_GIMME, 0);
   class_addmethod(c, (method)lpad_anything, "anything",  A_GIMME, 0);
+  class_addmethod(c, (method)lpad_frames,   "frames",    A_GIMME, 0);
   class_addmethod(c, (method)stdinletinfo,  "inletinfo", A_CANT,  0);
   class_addmethod(c, (method)lpad_clear,    "clear",              0);
   class_addmethod(c, (method)lpad_reset,    "reset",              0);
@@ -115,6 +143,14 @@ void ext_main(void *r)
   CLASS_ATTR_SAVE     (c, "warnings", 0);
   CLASS_ATTR_SELFSAVE (c, "warnings", 0);
 
+  CLASS_ATTR_CHAR     (c, "window", 0, t_lpad, window);
+  CLASS_ATTR_ORDER    (c, "window", 0, "3");
+  CLASS_ATTR_STYLE    (c, "window", 0, "onoff");
+  CLASS_ATTR_LABEL    (c, "window", 0, "sliding window mode");
+  CLASS_ATTR_FILTER_CLIP(c, "window", 0, 1);
+  CLASS_ATTR_SAVE     (c, "window", 0);
+  CLASS_ATTR_SELFSAVE (c, "window", 0);
+
   class_register(CLASS_BOX, c);
   lpad_class = c;
 }
@@ -141,9 +177,17 @@ void *lpad_new(t_symbol *sym, long argc, t_atom *argv)
   // Initialize the attributes
   x->maxlen = 0;
   x->warnings = 1;
+  x->window = 0;
 
   // Initialize the message structures
   mess_init(x->o_list);
+  mess_init(x->o_frames);
+  mess_init(x->ring);
+  x->pad_valid = false;
+  x->pad_end = 0;
+  x->ring_pos = 0;
+  x->ring_len = 0;
+  x->alloc_pending = false;
 
   // Process the attribute arguments
   attr_args_process(x, (short)argc, argv);
@@ -184,7 +228,7 @@ void *lpad_new(t_symbol *sym, long argc, t_atom *argv)
     break;
   }
 
-  lpad_action(x, sym_empty, 0, NULL, 0);
+  x->pad_valid = false;
   return x;
 }
 
@@ -200,8 +244,10 @@ void lpad_free(t_lpad *x)
   freeobject((t_object *)x->inl_proxy_2);
   freeobject((t_object *)x->inl_proxy_3);
 
-  // Free the message structure
+  // Free the message structures
   mess_clear(x->o_list);
+  mess_clear(x->o_frames);
+  mess_clear(x->ring);
 }
 
 /****************************************************************
@@ -241,6 +287,8 @@ void lpad_bang(t_lpad *x)
 {
   TRACE("lpad_bang");
 
+  ASSERT_ALLOC;
+
   lpad_output(x);
 }
 
@@ -266,11 +314,13 @@ void lpad_int(t_lpad *x, t_atom_long n)
   // Left padding length
   case 1:
     x->i_pad_left = CLAMP((t_mess_int)n, 0, x->maxlen);
+    x->pad_valid = false;
     break;
 
   // Padding value
   case 2:
     atom_setlong(x->i_pad_val, n);
+    x->pad_valid = false;
     break;
 
   // Output length
@@ -302,11 +352,13 @@ void lpad_float(t_lpad *x, double f)
   // Left padding length
   case 1:
     x->i_pad_left = CLAMP((t_mess_int)f, 0, x->maxlen);
+    x->pad_valid = false;
     break;
 
   // Padding value
   case 2:
     atom_setfloat(x->i_pad_val, f);
+    x->pad_valid = false;
     break;
 
   // Output length
@@ -357,6 +409,7 @@ void lpad_anything(t_lpad *x, t_symbol *sym, long argc, t_atom *argv)
   // Padding value
   case 2:
     atom_setsym(x->i_pad_val, sym);
+    x->pad_valid = false;
     WARN(argc && x->warnings, "Use a single number or symbol to set the padding value.");
     break;
 
@@ -366,28 +419,80 @@ void lpad_anything(t_lpad *x, t_symbol *sym, long argc, t_atom *argv)
   }
 }
 
+/****************************************************************
+*  Process batches of frames
+*
+*  The frames are processed in order as if they had been received
+*  separately in the left inlet, and the outputs are concatenated.
+*/
+void lpad_frames(t_lpad *x, t_symbol *sym, long argc, t_atom *argv)
+{
+  TRACE("lpad_frames");
+
+  switch (proxy_getinlet((t_object *)x)) {
+
+  // Frames should go into the first inlet
+  case 0:
+    ASSERT_ALLOC;
+    break;
+
+  default:
+    ERR("frames:  Batches of frames should go into the first inlet.");
+    return;
+  }
+
+  t_mess_int stride;
+  t_mess_int frames = frames_parse(&argc, &argv, &stride, x, x->warnings);
+  if (!frames) { return; }
+
+  // Each frame is output at the output length
+  if (!frames_reserve(x->o_frames, frames, x->o_list->len_cur, MESS_ALLOC_DEFAULT, x, x->warnings)) { return; }
+
+  x->o_frames->len_cur = 0;
+  for (t_mess_int f = 0; f < frames; f++) {
+    lpad_action(x, sym_list, stride, argv + f * stride, 0);
+    mess_cat(x->o_frames, x->o_list, x, x->warnings);
+  }
+
+  mess_set_type(x->o_frames);
+  mess_outlet(x->o_frames, x->outl_list);
+}
+
 /****************************************************************
 *  Clear the list
 *
 *  Sets the list to 0s without changing the length.
+*  In window mode, the window is also set to 0s.
 */
 void lpad_clear(t_lpad *x)
 {
   TRACE("lpad_clear");
 
+  ASSERT_ALLOC;
+
   mess_fill_int(x->o_list, 0, x->o_list->len_cur);
+  x->pad_valid = false;
+
+  mess_fill_int(x->ring, 0, x->ring_len);
+  x->ring_pos = 0;
 }
 
 /****************************************************************
 *  Reset the list
 *
 *  Sets the list to the padding value without changing the length.
+*  In window mode, the window is also reset to the padding value.
 */
 void lpad_reset(t_lpad *x)
 {
   TRACE("lpad_reset");
 
+  ASSERT_ALLOC;
+
   mess_fill_atom(x->o_list, x->i_pad_val, x->o_list->len_cur);
+  x->pad_valid = false;
+
+  x->ring_len = 0;
 }
 
 /****************************************************************
@@ -413,6 +518,7 @@ void lpad_post(t_lpad *x)
   }
 
   mess_post(x->o_list, "Padded list", x);
+  mess_post(x->o_frames, "Padded frames", x);
 }
 
 /****************************************************************
@@ -423,40 +529,123 @@ void lpad_defaults(t_lpad *x)
   x->i_pad_left = 0;
   atom_setlong(x->i_pad_val, 0);
   x->o_list->len_cur = x->maxlen;
+  x->pad_valid = false;
+  x->pad_end = 0;
+  x->ring_len = 0;
 }
 
 /****************************************************************
 *  The specific list action
+*
+*  The padding regions are kept between calls: if the padding is unchanged,
+*  only the payload and the end of the previous payload are overwritten.
 */
 void lpad_action(t_lpad *x, t_symbol *sym, long argc, t_atom *argv, char offset)
 {
   TRACE("lpad_action");
 
+  if (x->window) { lpad_window(x, sym, argc, argv, offset); return; }
+
   if (argc + offset + x->i_pad_left > x->maxlen) {
       WARN(x->warnings, "The input message is clipped from length %i to %i.",
         argc + offset, x->maxlen - x->i_pad_left);
   }
 
   t_atom *list = x->o_list->list;
-
-  // Padding left
   t_mess_int cnt = MIN(x->i_pad_left, x->maxlen);
-  for (t_int32 i = 0; i < cnt; i++) { *list++ = *x->i_pad_val; }
+
+  // Padding left, only if it is not valid
+  if (x->pad_valid) { list += cnt; }
+  else {
+    for (t_int32 i = 0; i < cnt; i++) { *list++ = *x->i_pad_val; }
+  }
 
   // First atom, if set
   if (offset && ((list - x->o_list->list) < x->maxlen)) { atom_setsym(list++, sym); }
 
   // Remaining atoms from the list
   cnt = MIN(argc, x->maxlen - (t_mess_int)(list - x->o_list->list));
-  for (t_int32 i = 0; i < cnt; i++) { *list++ = *argv++; }
+  if (cnt > 0) { ATOMS_COPY(list, argv, cnt); }
+  list += MAX(0, cnt);
 
-  // Right padding
-  cnt = MAX(0, x->maxlen - (t_mess_int)(list - x->o_list->list));
+  // Right padding:  all of it if not valid, otherwise only the end of the previous payload
+  t_mess_int end = (t_mess_int)(list - x->o_list->list);
+  cnt = (x->pad_valid ? MIN(x->pad_end, x->maxlen) : x->maxlen) - end;
   for (t_int32 i = 0; i < cnt; i++) { *list++ = *x->i_pad_val; }
 
+  x->pad_valid = true;
+  x->pad_end = end;
+
+  mess_set_type(x->o_list);
+}
+
+/****************************************************************
+*  The list action in window mode
+*
+*  The input is appended to a ring buffer of the output length,
+*  which is then unwrapped into the output list with two copies.
+*  The ring is reset to the padding value when the output length changes.
+*/
+void lpad_window(t_lpad *x, t_symbol *sym, long argc, t_atom *argv, char offset)
+{
+  TRACE("lpad_window");
+
+  t_mess_int len = x->o_list->len_cur;
+  t_atom atom[1];
+
+  // The output list does not hold the padding anymore
+  x->pad_valid = false;
+
+  // Reset the ring if necessary
+  if (x->ring_len != len) {
+    mess_fill_atom(x->ring, x->i_pad_val, len);
+    x->ring_pos = 0;
+    x->ring_len = len;
+  }
+  if (len == 0) { mess_set_type(x->o_list); return; }
+
+  // Append the first atom, if set, and the list
+  if (offset) {
+    atom_setsym(atom, sym);
+    lpad_ring_push(x, atom, 1);
+  }
+  lpad_ring_push(x, argv, (t_mess_int)argc);
+
+  // Unwrap from the oldest atom
+  t_mess_int cnt = len - x->ring_pos;
+  ATOMS_COPY(x->o_list->list, x->ring->list + x->ring_pos, cnt);
+  ATOMS_COPY(x->o_list->list + cnt, x->ring->list, x->ring_pos);
+
   mess_set_type(x->o_list);
 }
 
+/****************************************************************
+*  Append atoms to the ring buffer
+*
+*  If there are more atoms than the ring length, only the last ones are kept.
+*/
+void lpad_ring_push(t_lpad *x, t_atom *argv, t_mess_int cnt)
+{
+  t_mess_int len = x->ring_len;
+  t_atom *ring = x->ring->list;
+
+  if (cnt <= 0) { return; }
+
+  // The ring is overwritten entirely
+  if (cnt >= len) {
+    ATOMS_COPY(ring, argv + cnt - len, len);
+    x->ring_pos = 0;
+  }
+
+  // ... or written in at most two parts
+  else {
+    t_mess_int cnt1 = MIN(cnt, len - x->ring_pos);
+    ATOMS_COPY(ring + x->ring_pos, argv, cnt1);
+    ATOMS_COPY(ring, argv + cnt1, cnt - cnt1);
+    x->ring_pos = (x->ring_pos + cnt) % len;
+  }
+}
+
 /****************************************************************
 *  Output function
 */
@@ -485,19 +674,47 @@ t_max_err lpad_maxlen_set(t_lpad *x, void *attr, long argc, t_atom *argv)
   }
   if (maxlen == x->maxlen) { return MAX_ERR_NONE; }
 
+  // Free the lists, they are allocated on first use
+  mess_clear(x->o_list);
+  mess_clear(x->o_frames);
+  mess_clear(x->ring);
+
+  x->maxlen = maxlen;
+  x->alloc_pending = true;
+  lpad_defaults(x);
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Allocate the lists and set the padding
+*
+*  Called on first use through ASSERT_ALLOC.
+*  The output length, stored in the output list, is preserved.
+*/
+t_max_err lpad_alloc(t_lpad *x)
+{
+  TRACE("lpad_alloc");
+
+  t_mess_int len = x->o_list->len_cur;
+  x->alloc_pending = false;
+
   // Realloc the lists
-  mess_realloc(x->o_list, maxlen, x);
+  mess_realloc(x->o_list, x->maxlen, x);
+  mess_realloc(x->o_frames, x->maxlen, x);
+  mess_realloc(x->ring, x->maxlen, x);
 
   // Test the allocation
-  if (MESS_IS_NULL(x->o_list)) {
+  if (MESS_IS_NULL(x->o_list) || MESS_IS_NULL(x->o_frames) || MESS_IS_NULL(x->ring)) {
     mess_clear(x->o_list);
+    mess_clear(x->o_frames);
+    mess_clear(x->ring);
     x->maxlen = 0;
     return MAX_ERR_OUT_OF_MEM;
   }
-  else {
-    x->maxlen = maxlen;
-    lpad_defaults(x);
-    lpad_action(x, sym_empty, 0, NULL, 0);
-    return MAX_ERR_NONE;
-  }
+
+  x->o_list->len_cur = len;
+  x->pad_valid = false;
+  x->ring_len = 0;
+  lpad_action(x, sym_empty, 0, NULL, 0);
+  return MAX_ERR_NONE;
 }
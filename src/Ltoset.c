@@ -9,6 +9,16 @@
 *    - The external uses the new style Max object and attributes.
 *    - The arrays to store lists and messages are resizable.
 *    - Non int, float or list messages can be processed (starting with a symbol).
+*    - The set is stored as a bitset, and expanded to atoms only for output.
+*    - The number of members is sent out of the right outlet.
+*    - With the output attribute set to bitmask, the set is sent as ints of 32 bits.
+*    - Set algebra with an index list or a bitmask:
+*        union | intersect | diff | xor <indexes>
+*        union | intersect | diff | xor mask <ints>
+*    - The indexes message sends the list of members.
+*    - With the sparse attribute, any index >= 0 can be a member. Up to maxlen
+*      members are stored in a hash table, and the output is a window of the set
+*      starting at the window attribute. The indexes message sends the sorted members.
 */
 
 /****************************************************************
@@ -26,10 +36,25 @@ typedef struct _ltoset
   t_object obj;
 
   // Inlets, proxies and outlets
+  void *outl_card;
   void *outl_list;
 
   // Input variables
-  long i_value;
+  long       i_value;
+  t_mess_int i_len;      // length of the sets
+
+  // Set members, one bit per position, and operand of the set algebra
+  t_uint64  *bits;
+  t_uint64  *bits_in;
+
+  // Hashed set of members, for the sparse mode
+  t_atom_long *table;       // open addressing with linear probing, empty slots are -1
+  t_mess_int  *table_slots; // slots of the members, in order of insertion
+  t_mess_int   table_size;  // power of 2, at least twice maxlen
+  t_mess_int   table_cnt;   // number of members
+
+  // Lazy allocation:  true until the lists are allocated on first use
+  t_bool alloc_pending;
 
   // Output messages
   t_mess_struct o_list[1];
@@ -37,6 +62,9 @@ typedef struct _ltoset
   // Attributes
   t_mess_int maxlen;     // maximum list length
   char       warnings;   // report warnings or not
+  char       output;     // output format:  0: list - 1: bitmask
+  char       sparse;     // sparse mode with hashed members
+  t_atom_long window;    // start of the output window in sparse mode
 
 } t_ltoset;
 
@@ -45,6 +73,15 @@ typedef struct _ltoset
 */
 static t_class *ltoset_class = NULL;
 
+/****************************************************************
+*  Symbols for the set algebra
+*/
+static t_symbol *sym_union     = NULL;
+static t_symbol *sym_intersect = NULL;
+static t_symbol *sym_diff      = NULL;
+static t_symbol *sym_xor       = NULL;
+static t_symbol *sym_mask      = NULL;
+
 /****************************************************************
 *  Function declarations
 */
@@ -59,14 +96,35 @@ void  ltoset_in2      (t_ltoset *x, t_atom_long value);
 void  ltoset_float    (t_ltoset *x, double f);
 void  ltoset_list     (t_ltoset *x, t_symbol *sym, long argc, t_atom *argv);
 void  ltoset_anything (t_ltoset *x, t_symbol *sym, long argc, t_atom *argv);
+void  ltoset_algebra  (t_ltoset *x, t_symbol *sym, long argc, t_atom *argv);
+void  ltoset_indexes  (t_ltoset *x);
 void  ltoset_clear    (t_ltoset *x);
 void  ltoset_post     (t_ltoset *x);
 
 void  ltoset_defaults (t_ltoset *x);
 void  ltoset_action   (t_ltoset *x, long argc, t_atom *argv);
+void  ltoset_bits_clear (t_ltoset *x);
+void  ltoset_bits_parse (t_ltoset *x, long argc, t_atom *argv);
+t_mess_int ltoset_card (t_ltoset *x);
+void  ltoset_expand   (t_ltoset *x);
+void  ltoset_pack     (t_ltoset *x);
 void  ltoset_output   (t_ltoset *x);
 
+t_bool ltoset_table_alloc  (t_ltoset *x, t_mess_int maxlen);
+void  ltoset_table_clear  (t_ltoset *x);
+t_mess_int ltoset_table_hash (t_ltoset *x, t_atom_long key);
+void  ltoset_table_add    (t_ltoset *x, t_atom_long key);
+void  ltoset_table_window (t_ltoset *x);
+int   ltoset_compare      (const void *atom1, const void *atom2);
+
+t_max_err ltoset_alloc      (t_ltoset *x);
 t_max_err ltoset_maxlen_set (t_ltoset *x, void *attr, long argc, t_atom *argv);
+t_max_err ltoset_sparse_set (t_ltoset *x, void *attr, long argc, t_atom *argv);
+
+/****************************************************************
+*  Allocation function called by ASSERT_ALLOC
+*/
+#define ALLOC_FUNCTION ltoset_alloc
 
 /****************************************************************
 *  Initialization
@@ -75,6 +133,11 @@ void ext_main(void *r)
 {
   // Initialize frequently used symbols
   sym_init();
+  sym_union     = gensym("union");
+  sym_intersect = gensym("intersect");
+  sym_diff      = gensym("diff");
+  sym_xor       = gensym("xor");
+  sym_mask      = gensym("mask");
 
   t_class *c;
 
@@ -92,6 +155,11 @@ void ext_main(void *r)
   class_addmethod(c, (method)ltoset_float,    "float",     A_FLOAT, 0);
   class_addmethod(c, (method)ltoset_list,     "list",      A_GIMME, 0);
   class_addmethod(c, (method)ltoset_anything, "anything",  A_GIMME, 0);
+  class_addmethod(c, (method)ltoset_algebra,  "union",     A_GIMME, 0);
+  class_addmethod(c, (method)ltoset_algebra,  "intersect", A_GIMME, 0);
+  class_addmethod(c, (method)ltoset_algebra,  "diff",      A_GIMME, 0);
+  class_addmethod(c, (method)ltoset_algebra,  "xor",       A_GIMME, 0);
+  class_addmethod(c, (method)ltoset_indexes,  "indexes",            0);
   class_addmethod(c, (method)stdinletinfo,    "inletinfo", A_CANT,  0);
   class_addmethod(c, (method)ltoset_clear,    "clear",              0);
   class_addmethod(c, (method)ltoset_post,     "post",               0);
@@ -112,6 +180,29 @@ void ext_main(void *r)
   CLASS_ATTR_SAVE     (c, "warnings", 0);
   CLASS_ATTR_SELFSAVE (c, "warnings", 0);
 
+  CLASS_ATTR_CHAR     (c, "output", 0, t_ltoset, output);
+  CLASS_ATTR_ORDER    (c, "output", 0, "3");
+  CLASS_ATTR_ENUMINDEX(c, "output", 0, "list bitmask");
+  CLASS_ATTR_LABEL    (c, "output", 0, "output format");
+  CLASS_ATTR_FILTER_CLIP(c, "output", 0, 1);
+  CLASS_ATTR_SAVE     (c, "output", 0);
+  CLASS_ATTR_SELFSAVE (c, "output", 0);
+
+  CLASS_ATTR_CHAR     (c, "sparse", 0, t_ltoset, sparse);
+  CLASS_ATTR_ORDER    (c, "sparse", 0, "4");
+  CLASS_ATTR_STYLE    (c, "sparse", 0, "onoff");
+  CLASS_ATTR_LABEL    (c, "sparse", 0, "sparse mode");
+  CLASS_ATTR_SAVE     (c, "sparse", 0);
+  CLASS_ATTR_SELFSAVE (c, "sparse", 0);
+  CLASS_ATTR_ACCESSORS(c, "sparse", NULL, ltoset_sparse_set);
+
+  CLASS_ATTR_ATOM_LONG(c, "window", 0, t_ltoset, window);
+  CLASS_ATTR_ORDER    (c, "window", 0, "5");
+  CLASS_ATTR_LABEL    (c, "window", 0, "start of the output window");
+  CLASS_ATTR_FILTER_MIN(c, "window", 0);
+  CLASS_ATTR_SAVE     (c, "window", 0);
+  CLASS_ATTR_SELFSAVE (c, "window", 0);
+
   class_register(CLASS_BOX, c);
   ltoset_class = c;
 }
@@ -131,14 +222,25 @@ void *ltoset_new(t_symbol *sym, long argc, t_atom *argv)
   // Set inlets and outlets
   intin(x, 2);
   intin(x, 1);
+  x->outl_card = intout((t_object *)x);
   x->outl_list = outlet_new((t_object *)x, NULL);
 
   // Initialize the attributes
   x->maxlen = 0;
   x->warnings = 1;
+  x->output = 0;
+  x->sparse = 0;
+  x->window = 0;
 
-  // Initialize the message structures
+  // Initialize the message structures and the bitset
   mess_init(x->o_list);
+  x->bits = NULL;
+  x->bits_in = NULL;
+  x->table = NULL;
+  x->table_slots = NULL;
+  x->table_size = 0;
+  x->table_cnt = 0;
+  x->alloc_pending = false;
 
   // Process the attribute arguments
   attr_args_process(x, (short)argc, argv);
@@ -157,7 +259,7 @@ void *ltoset_new(t_symbol *sym, long argc, t_atom *argv)
   if (argc >= 1) {
     if (((atom_gettype(argv) == A_LONG) || (atom_gettype(argv) == A_FLOAT))) {
 
-      x->o_list->len_cur = CLAMP((t_mess_int)atom_getlong(argv), 1, x->maxlen);
+      x->i_len = CLAMP((t_mess_int)atom_getlong(argv), 1, x->maxlen);
       if ((atom_getlong(argv) < 1) || (atom_getlong(argv) > x->maxlen)) {
         WARN(x->warnings, "Arg 1:  List length:  Out of range. Clipped to [1, %i].", x->maxlen);
       }
@@ -183,8 +285,12 @@ void ltoset_free(t_ltoset *x)
 {
   TRACE("ltoset_free");
 
-  // Free the message structures
+  // Free the message structures and the bitset
   mess_clear(x->o_list);
+  if (x->bits) { sysmem_freeptr(x->bits); }
+  if (x->bits_in) { sysmem_freeptr(x->bits_in); }
+  if (x->table) { sysmem_freeptr(x->table); }
+  if (x->table_slots) { sysmem_freeptr(x->table_slots); }
 }
 
 /****************************************************************
@@ -204,6 +310,7 @@ void ltoset_assist(t_ltoset *x, void *b, long msg, long arg, char *dst)
   case ASSIST_OUTLET:
     switch (arg) {
     case 0: sprintf(dst, "list of %is and values (list)", x->i_value); break;
+    case 1: sprintf(dst, "number of members (int)"); break;
     default: break;
     }
     break;
@@ -230,7 +337,7 @@ void ltoset_int(t_ltoset *x, t_atom_long n)
   ASSERT_ALLOC;
 
   t_atom atom[1];
-  atom_setlong(atom, CLAMP(n, 0, x->o_list->len_cur - 1));
+  atom_setlong(atom, x->sparse ? n : CLAMP(n, 0, x->i_len - 1));
   ltoset_action(x, 1, atom);
   ltoset_output(x);
 }
@@ -252,17 +359,20 @@ void ltoset_in2(t_ltoset *x, t_atom_long length)
 {
   TRACE("ltoset_in2");
 
-  x->o_list->len_cur = CLAMP((t_mess_int)length, 1, x->maxlen);
+  x->i_len = CLAMP((t_mess_int)length, 1, x->maxlen);
 }
 
 /****************************************************************
 *  Process float inputs
+*
+*  Same as ltoset_int():  the sparse mode keeps the full range of the IDs,
+*  the dense mode clamps to the length before the conversion.
 */
 void ltoset_float(t_ltoset *x, double f)
 {
   TRACE("ltoset_float");
 
-  ltoset_int(x, (t_mess_int)f);
+  ltoset_int(x, x->sparse ? (t_atom_long)f : (t_atom_long)CLAMP(f, 0, x->i_len - 1));
 }
 
 /****************************************************************
@@ -292,6 +402,81 @@ void ltoset_anything(t_ltoset *x, t_symbol *sym, long argc, t_atom *argv)
   ltoset_output(x);
 }
 
+/****************************************************************
+*  Set algebra between the set and an index list or a bitmask
+*
+*  The operation is given by the message selector:  union, intersect, diff or xor.
+*/
+void ltoset_algebra(t_ltoset *x, t_symbol *sym, long argc, t_atom *argv)
+{
+  TRACE("ltoset_algebra");
+
+  ASSERT_ALLOC;
+
+  if (x->sparse) { ERR("%s:  Not available in sparse mode.", sym->s_name); return; }
+
+  t_uint64 *bits = x->bits;
+  t_uint64 *in = x->bits_in;
+  t_mess_int words = BITS_WORDS(x->maxlen);
+
+  ltoset_bits_parse(x, argc, argv);
+
+  // Word-wide operations
+  if (sym == sym_union) {
+    for (t_mess_int w = 0; w < words; w++) { bits[w] |= in[w]; }
+  }
+  else if (sym == sym_intersect) {
+    for (t_mess_int w = 0; w < words; w++) { bits[w] &= in[w]; }
+  }
+  else if (sym == sym_diff) {
+    for (t_mess_int w = 0; w < words; w++) { bits[w] &= ~in[w]; }
+  }
+  else if (sym == sym_xor) {
+    for (t_mess_int w = 0; w < words; w++) { bits[w] ^= in[w]; }
+  }
+
+  ltoset_output(x);
+}
+
+/****************************************************************
+*  Output the list of members, in increasing order
+*/
+void ltoset_indexes(t_ltoset *x)
+{
+  TRACE("ltoset_indexes");
+
+  ASSERT_ALLOC;
+
+  t_atom *out = x->o_list->list;
+  t_uint64 word;
+  t_mess_int index;
+
+  // Sparse mode:  gather and sort the members
+  if (x->sparse) {
+    for (t_mess_int i = 0; i < x->table_cnt; i++) { atom_setlong(out++, x->table[x->table_slots[i]]); }
+    qsort(x->o_list->list, x->table_cnt, sizeof(t_atom), ltoset_compare);
+  }
+
+  // ... or dense mode
+  else {
+    for (t_mess_int w = 0; w < BITS_WORDS(x->i_len); w++) {
+
+      // Scan the set bits, clearing the lowest one each time
+      for (word = x->bits[w]; word; word &= word - 1) {
+        index = 64 * w + bits_ctz(word);
+        if (index >= x->i_len) { break; }
+        atom_setlong(out++, index);
+      }
+    }
+  }
+
+  x->o_list->len_cur = (t_mess_int)(out - x->o_list->list);
+  mess_set_type(x->o_list);
+
+  outlet_int(x->outl_card, x->o_list->len_cur);
+  mess_outlet(x->o_list, x->outl_list);
+}
+
 /****************************************************************
 *  Clear the lists
 */
@@ -299,7 +484,10 @@ void ltoset_clear(t_ltoset *x)
 {
   TRACE("ltoset_clear");
 
-  mess_fill_int(x->o_list, 0, x->o_list->len_cur);
+  ASSERT_ALLOC;
+
+  if (x->sparse) { ltoset_table_clear(x); }
+  else { ltoset_bits_clear(x); }
 }
 
 /****************************************************************
@@ -309,8 +497,15 @@ void ltoset_post(t_ltoset *x)
 {
   TRACE("ltoset_post");
 
-  POST("Max length: %i - Warnings: %i - Set value: %i - Set length: %i",
-    x->maxlen, x->warnings, x->i_value, x->o_list->len_cur);
+  ASSERT_ALLOC;
+
+  POST("Max length: %i - Warnings: %i - Set value: %i - Set length: %i - Members: %i",
+    x->maxlen, x->warnings, x->i_value, x->i_len, ltoset_card(x));
+  if (x->sparse) {
+    POST("Sparse mode - Window: %lld - Table size: %i", (long long)x->window, x->table_size);
+    ltoset_table_window(x);
+  }
+  ltoset_expand(x);
   mess_post(x->o_list, "Output list", x);
 }
 
@@ -320,7 +515,7 @@ void ltoset_post(t_ltoset *x)
 void ltoset_defaults(t_ltoset *x)
 {
   x->i_value = 1;
-  x->o_list->len_cur = MIN(12, x->maxlen);
+  x->i_len = MIN(12, x->maxlen);
 }
 
 /****************************************************************
@@ -330,10 +525,22 @@ void ltoset_action(t_ltoset *x, long argc, t_atom *argv)
 {
   TRACE("ltoset_action");
 
-  // Reset the output list to 0
-  mess_fill_int(x->o_list, 0, x->o_list->len_cur);
+  // Sparse mode:  reset and fill the hashed set
+  if (x->sparse) {
+    ltoset_table_clear(x);
+    for (long i = 0; i < argc; i++) {
+      if (atom_gettype(argv + i) == A_SYM) {
+        WARN(x->warnings, "Symbol in list. The object expects integers only.");
+      }
+      else if (atom_getlong(argv + i) >= 0) { ltoset_table_add(x, atom_getlong(argv + i)); }
+    }
+    return;
+  }
+
+  // Reset the set
+  ltoset_bits_clear(x);
 
-  // Set all members of the set to the value
+  // Add the members to the set
   t_mess_int index;
   for (long i = 0; i < argc; i++) {
     if (atom_gettype(argv + i) == A_SYM) {
@@ -341,25 +548,273 @@ void ltoset_action(t_ltoset *x, long argc, t_atom *argv)
     }
     else {
       index = (t_mess_int)atom_getlong(argv + i);
-      if ((index >= 0) && (index < x->maxlen)) {
-        atom_setlong(x->o_list->list + index, x->i_value);
+      if ((index >= 0) && (index < x->maxlen)) { BITS_SET(x->bits, index); }
+    }
+  }
+}
+
+/****************************************************************
+*  Clear the bitset, one word at a time
+*/
+__inline void ltoset_bits_clear(t_ltoset *x)
+{
+  for (t_mess_int w = 0; w < BITS_WORDS(x->maxlen); w++) { x->bits[w] = 0; }
+}
+
+/****************************************************************
+*  Set the operand bitset from an index list or a bitmask
+*
+*  A bitmask starts with the symbol mask, followed by ints of 32 bits.
+*/
+void ltoset_bits_parse(t_ltoset *x, long argc, t_atom *argv)
+{
+  TRACE("ltoset_bits_parse");
+
+  t_mess_int words = BITS_WORDS(x->maxlen);
+  t_mess_int index;
+
+  for (t_mess_int w = 0; w < words; w++) { x->bits_in[w] = 0; }
+
+  // Bitmask
+  if ((argc >= 1) && (atom_gettype(argv) == A_SYM) && (atom_getsym(argv) == sym_mask)) {
+    argc--;
+    argv++;
+    if (argc > 2 * words) {
+      WARN(x->warnings, "mask:  Truncated from %i to %i ints.", argc, 2 * words);
+      argc = 2 * words;
+    }
+    for (long i = 0; i < argc; i++) {
+      x->bits_in[i / 2] |= (t_uint64)((t_uint32)atom_getlong(argv + i)) << (32 * (i % 2));
+    }
+
+    // Clear the bits beyond maxlen
+    if (x->maxlen % 64) { x->bits_in[words - 1] &= ((t_uint64)1 << (x->maxlen % 64)) - 1; }
+  }
+
+  // ... or index list
+  else {
+    for (long i = 0; i < argc; i++) {
+      if (atom_gettype(argv + i) == A_SYM) {
+        WARN(x->warnings, "Symbol in list. The object expects integers only.");
+      }
+      else {
+        index = (t_mess_int)atom_getlong(argv + i);
+        if ((index >= 0) && (index < x->maxlen)) { BITS_SET(x->bits_in, index); }
+      }
+    }
+  }
+}
+
+/****************************************************************
+*  Get the number of members in the set, within the set length
+*/
+t_mess_int ltoset_card(t_ltoset *x)
+{
+  TRACE("ltoset_card");
+
+  if (x->sparse) { return x->table_cnt; }
+
+  t_mess_int words = x->i_len / 64;
+  t_mess_int card = 0;
+
+  for (t_mess_int w = 0; w < words; w++) { card += bits_popcount(x->bits[w]); }
+
+  // Mask the last partial word
+  if (x->i_len % 64) {
+    card += bits_popcount(x->bits[words] & (((t_uint64)1 << (x->i_len % 64)) - 1));
+  }
+
+  return card;
+}
+
+/****************************************************************
+*  Expand the bitset to a list of 0s and values
+*/
+void ltoset_expand(t_ltoset *x)
+{
+  TRACE("ltoset_expand");
+
+  t_atom *list = x->o_list->list;
+  t_uint64 word;
+  t_mess_int end;
+
+  for (t_mess_int beg = 0; beg < x->i_len; beg += 64) {
+
+    word = x->bits[beg / 64];
+    end = MIN(beg + 64, x->i_len);
+
+    // Empty words are filled without testing the bits
+    if (!word) {
+      for (t_mess_int i = beg; i < end; i++) { atom_setlong(list + i, 0); }
+    }
+    else {
+      for (t_mess_int i = beg; i < end; i++, word >>= 1) {
+        atom_setlong(list + i, (word & 1) ? x->i_value : 0);
       }
     }
   }
 
+  x->o_list->len_cur = x->i_len;
+  mess_set_type(x->o_list);
+}
+
+/****************************************************************
+*  Pack the bitset in a list of ints of 32 bits, from the lowest bit
+*/
+void ltoset_pack(t_ltoset *x)
+{
+  TRACE("ltoset_pack");
+
+  t_mess_int cnt = (x->i_len + 31) / 32;
+  t_uint64 word;
+
+  for (t_mess_int i = 0; i < cnt; i++) {
+    word = x->bits[i / 2] >> (32 * (i % 2));
+
+    // Mask the bits beyond the set length
+    if ((i == cnt - 1) && (x->i_len % 32)) { word &= ((t_uint64)1 << (x->i_len % 32)) - 1; }
+
+    atom_setlong(x->o_list->list + i, (t_atom_long)(word & 0xFFFFFFFF));
+  }
+
+  x->o_list->len_cur = cnt;
   mess_set_type(x->o_list);
 }
 
 /****************************************************************
 *  Output function
 */
-__inline void ltoset_output(t_ltoset *x)
+void ltoset_output(t_ltoset *x)
 {
   TRACE("ltoset_output");
 
+  ASSERT_ALLOC;
+
+  outlet_int(x->outl_card, ltoset_card(x));
+
+  if (x->sparse) { ltoset_table_window(x); }
+
+  if (x->output == 0) { ltoset_expand(x); }
+  else { ltoset_pack(x); }
+
   mess_outlet(x->o_list, x->outl_list);
 }
 
+/****************************************************************
+*  Allocate the hash table for the sparse mode
+*
+*  The table is only allocated in sparse mode, with at least twice
+*  as many slots as the maximum number of members, and the slots
+*  of the members are listed so that they can be visited in O(members).
+*  Returns false if the allocation failed.
+*/
+t_bool ltoset_table_alloc(t_ltoset *x, t_mess_int maxlen)
+{
+  TRACE("ltoset_table_alloc");
+
+  if (x->table) { sysmem_freeptr(x->table); x->table = NULL; }
+  if (x->table_slots) { sysmem_freeptr(x->table_slots); x->table_slots = NULL; }
+  x->table_size = 0;
+  x->table_cnt = 0;
+
+  if (!x->sparse || (maxlen <= 0)) { return true; }
+
+  t_mess_int size = 2;
+  while (size < 2 * maxlen) { size *= 2; }
+
+  x->table = (t_atom_long *)sysmem_newptr(size * sizeof(t_atom_long));
+  x->table_slots = (t_mess_int *)sysmem_newptr(maxlen * sizeof(t_mess_int));
+  if (!x->table || !x->table_slots) {
+    if (x->table) { sysmem_freeptr(x->table); x->table = NULL; }
+    if (x->table_slots) { sysmem_freeptr(x->table_slots); x->table_slots = NULL; }
+    return false;
+  }
+
+  x->table_size = size;
+  for (t_mess_int i = 0; i < size; i++) { x->table[i] = -1; }
+  return true;
+}
+
+/****************************************************************
+*  Clear the hash table, emptying only the slots of the members
+*/
+void ltoset_table_clear(t_ltoset *x)
+{
+  for (t_mess_int i = 0; i < x->table_cnt; i++) { x->table[x->table_slots[i]] = -1; }
+  x->table_cnt = 0;
+}
+
+/****************************************************************
+*  Get the first slot to probe for a key
+*/
+__inline t_mess_int ltoset_table_hash(t_ltoset *x, t_atom_long key)
+{
+  // 64 bit finalizer from MurmurHash3
+  t_uint64 hash = (t_uint64)key;
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53ULL;
+  hash ^= hash >> 33;
+
+  return (t_mess_int)(hash & (t_uint64)(x->table_size - 1));
+}
+
+/****************************************************************
+*  Add a key to the hash table
+*
+*  Keys already in the set are ignored.
+*  When the set holds maxlen members, new keys are dropped.
+*/
+void ltoset_table_add(t_ltoset *x, t_atom_long key)
+{
+  t_mess_int mask = x->table_size - 1;
+  t_mess_int slot = ltoset_table_hash(x, key);
+
+  while (x->table[slot] >= 0) {
+    if (x->table[slot] == key) { return; }
+    slot = (slot + 1) & mask;
+  }
+
+  if (x->table_cnt >= x->maxlen) {
+    WARN(x->warnings, "Sparse set full (%i members). Index %lld dropped.", x->maxlen, (long long)key);
+    return;
+  }
+
+  x->table[slot] = key;
+  x->table_slots[x->table_cnt++] = slot;
+}
+
+/****************************************************************
+*  Set the bitset to the window of the sparse set
+*
+*  The window starts at the window attribute and has the length of the sets.
+*/
+void ltoset_table_window(t_ltoset *x)
+{
+  TRACE("ltoset_table_window");
+
+  t_atom_long key;
+
+  ltoset_bits_clear(x);
+
+  for (t_mess_int i = 0; i < x->table_cnt; i++) {
+    key = x->table[x->table_slots[i]] - x->window;
+    if ((key >= 0) && (key < x->i_len)) { BITS_SET(x->bits, key); }
+  }
+}
+
+/****************************************************************
+*  Comparison function to sort the members
+*/
+int ltoset_compare(const void *atom1, const void *atom2)
+{
+  t_atom_long n1 = atom_getlong((t_atom *)atom1);
+  t_atom_long n2 = atom_getlong((t_atom *)atom2);
+
+  return (n1 > n2) - (n1 < n2);
+}
+
 /****************************************************************
 *  Setter function for the maxlen attribute
 */
@@ -378,18 +833,76 @@ t_max_err ltoset_maxlen_set(t_ltoset *x, void *attr, long argc, t_atom *argv)
   }
   if (maxlen == x->maxlen) { return MAX_ERR_NONE; }
 
-  // Realloc the lists
+  // Free the lists and the bitsets, they are allocated on first use
+  mess_clear(x->o_list);
+  if (x->bits) { sysmem_freeptr(x->bits); x->bits = NULL; }
+  if (x->bits_in) { sysmem_freeptr(x->bits_in); x->bits_in = NULL; }
+  ltoset_table_alloc(x, 0);
+
+  x->maxlen = maxlen;
+  x->alloc_pending = true;
+  ltoset_defaults(x);
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Allocate the lists and the bitsets
+*
+*  Called on first use through ASSERT_ALLOC.
+*/
+t_max_err ltoset_alloc(t_ltoset *x)
+{
+  TRACE("ltoset_alloc");
+
+  t_mess_int maxlen = x->maxlen;
+  x->alloc_pending = false;
+
+  // Realloc the lists and the bitsets
   mess_realloc(x->o_list, maxlen, x);
+  if (x->bits) { sysmem_freeptr(x->bits); }
+  if (x->bits_in) { sysmem_freeptr(x->bits_in); }
+  x->bits = (t_uint64 *)sysmem_newptr(BITS_WORDS(maxlen) * sizeof(t_uint64));
+  x->bits_in = (t_uint64 *)sysmem_newptr(BITS_WORDS(maxlen) * sizeof(t_uint64));
 
   // Test the allocation
-  if (MESS_IS_NULL(x->o_list)) {
+  if (MESS_IS_NULL(x->o_list) || !x->bits || !x->bits_in || !ltoset_table_alloc(x, maxlen)) {
     mess_clear(x->o_list);
+    if (x->bits) { sysmem_freeptr(x->bits); x->bits = NULL; }
+    if (x->bits_in) { sysmem_freeptr(x->bits_in); x->bits_in = NULL; }
+    ltoset_table_alloc(x, 0);
     x->maxlen = 0;
     return MAX_ERR_OUT_OF_MEM;
   }
-  else {
-    x->maxlen = maxlen;
-    ltoset_defaults(x);
-    return MAX_ERR_NONE;
+
+  ltoset_bits_clear(x);
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Setter function for the sparse attribute
+*
+*  The set is cleared when switching modes.
+*/
+t_max_err ltoset_sparse_set(t_ltoset *x, void *attr, long argc, t_atom *argv)
+{
+  TRACE("ltoset_sparse_set");
+
+  // If no arguments, do nothing
+  if (!argc || !argv) { return MAX_ERR_GENERIC; }
+
+  char sparse = atom_getlong(argv) ? 1 : 0;
+  if (sparse == x->sparse) { return MAX_ERR_NONE; }
+  x->sparse = sparse;
+
+  // Before allocation, only set the value
+  if (!x->maxlen || x->alloc_pending) { return MAX_ERR_NONE; }
+
+  ltoset_bits_clear(x);
+  if (!ltoset_table_alloc(x, x->maxlen)) {
+    ERR("sparse:  Allocation of the hash table failed.");
+    x->sparse = 0;
+    return MAX_ERR_OUT_OF_MEM;
   }
+
+  return MAX_ERR_NONE;
 }
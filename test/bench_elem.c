@@ -0,0 +1,92 @@
+/**
+*  @file
+*  Benchmark of the element-wise engine, with Lmax and the stand-in for the Max SDK
+*
+*  Times the hot and cold inputs of lists of floats, processed as atoms (precision 64)
+*  or packed as 32 bit floats (precision 32), and the input of short cold lists
+*  with a long maximum length, recomputed with a short left list.
+*  Then the cost per message of the hot input of short lists, of lengths 1 to 16.
+*/
+
+#include "ext.h"
+#include "ext_obex.h"
+#include "Lobjects.h"
+#include "Lelem.h"
+
+void ext_main(void *r);
+
+#define MAXLEN 65536
+
+static t_atom atoms[MAXLEN];
+
+static t_lelem *lmax_new(long precision)
+{
+  t_atom argv[4];
+  atom_setsym(argv, gensym("@maxlen"));
+  atom_setlong(argv + 1, MAXLEN);
+  atom_setsym(argv + 2, gensym("@precision"));
+  atom_setlong(argv + 3, precision);
+  return (t_lelem *)lelem_new(gensym("Lmax"), 4, argv);
+}
+
+static void send_list(t_lelem *x, long inlet, t_mess_int len)
+{
+  standin_inlet = inlet;
+  lelem_list(x, gensym("list"), len, atoms);
+  standin_inlet = 0;
+}
+
+// Time an input, in microseconds per input, as the best of several rounds
+static double bench(t_lelem *x, long inlet, t_mess_int len, long reps)
+{
+  double best = 1e300;
+
+  for (int round = 0; round < 5; round++) {
+    double time = systimer_gettime();
+    for (long r = 0; r < reps; r++) { send_list(x, inlet, len); }
+    time = (systimer_gettime() - time) * 1000.0 / reps;
+    if (time < best) { best = time; }
+  }
+  return best;
+}
+
+int main(void)
+{
+  ext_main(NULL);
+
+  srand(1);
+  for (t_mess_int i = 0; i < MAXLEN; i++) { atom_setfloat(atoms + i, (double)rand() / RAND_MAX); }
+
+  printf("Lmax, lists of %i floats, microseconds per input\n", MAXLEN);
+  printf("%-28s %12s %12s\n", "", "precision 64", "precision 32");
+
+  t_lelem *x64 = lmax_new(64);
+  t_lelem *x32 = lmax_new(32);
+
+  send_list(x64, 1, MAXLEN);
+  send_list(x32, 1, MAXLEN);
+  printf("%-28s %12.1f %12.1f\n", "hot input", bench(x64, 0, MAXLEN, 200), bench(x32, 0, MAXLEN, 200));
+  printf("%-28s %12.1f %12.1f\n", "cold input", bench(x64, 1, MAXLEN, 200), bench(x32, 1, MAXLEN, 200));
+
+  // Short cold lists, recomputed with a short left list
+  send_list(x64, 0, 16);
+  send_list(x32, 0, 16);
+  printf("%-28s %12.2f %12.2f\n", "cold input of 1024", bench(x64, 1, 1024, 2000), bench(x32, 1, 1024, 2000));
+  printf("%-28s %12.2f %12.2f\n", "cold input of 16", bench(x64, 1, 16, 20000), bench(x32, 1, 16, 20000));
+
+  // Short lists, hot input with a cold list of the same length
+  printf("\nLmax, short lists of floats, nanoseconds per input\n");
+  printf("%-28s %12s %12s\n", "", "precision 64", "precision 32");
+  for (t_mess_int len = 1; len <= 16; len++) {
+    char label[32];
+    snprintf(label, sizeof(label), "hot input of %i", len);
+    send_list(x64, 1, len);
+    send_list(x32, 1, len);
+    printf("%-28s %12.1f %12.1f\n", label, bench(x64, 0, len, 200000) * 1000.0, bench(x32, 0, len, 200000) * 1000.0);
+  }
+
+  object_free(x64);
+  object_free(x32);
+  standin_quit();
+  return 0;
+}
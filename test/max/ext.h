@@ -0,0 +1,181 @@
+/**
+*  @file
+*  Stand-in for the Max SDK, to build and test the externals on Linux
+*
+*  Only the part of the API used by the externals is declared, with the
+*  same names and signatures. The scheduler is simulated by standin_service(),
+*  which runs the qelems that are set and the clocks that are due.
+*/
+
+#ifndef YC_STANDIN_EXT_H_
+#define YC_STANDIN_EXT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+/****************************************************************
+*  Types
+*/
+typedef int32_t   t_int32;
+typedef uint32_t  t_uint32;
+typedef int64_t   t_int64;
+typedef uint64_t  t_uint64;
+typedef intptr_t  t_ptr_int;
+typedef uintptr_t t_ptr_uint;
+typedef t_ptr_int t_atom_long;
+typedef double    t_atom_float;
+typedef t_ptr_int t_max_err;
+typedef long      t_bool;
+
+typedef void *(*method)(void *, ...);
+
+typedef struct _object
+{
+  void *o_messlist;   // the class of the object
+} t_object;
+
+typedef struct _symbol
+{
+  char     *s_name;
+  t_object *s_thing;
+} t_symbol;
+
+union word
+{
+  t_atom_long w_long;
+  double      w_float;
+  t_symbol   *w_sym;
+  t_object   *w_obj;
+};
+
+typedef struct _atom
+{
+  short      a_type;
+  union word a_w;
+} t_atom;
+
+typedef struct _class   t_class;
+typedef struct _qelem   t_qelem;
+typedef struct _clock   t_clock;
+typedef struct _hashtab t_hashtab;
+
+enum { A_NOTHING = 0, A_LONG, A_FLOAT, A_SYM, A_OBJ, A_DEFLONG, A_DEFFLOAT, A_DEFSYM, A_GIMME, A_CANT };
+enum { MAX_ERR_NONE = 0, MAX_ERR_GENERIC = -1, MAX_ERR_INVALID_PTR = -2, MAX_ERR_DUPLICATE = -3, MAX_ERR_OUT_OF_MEM = -4 };
+enum { ASSIST_INLET = 1, ASSIST_OUTLET = 2 };
+
+#define OBJ_FLAG_DATA 2
+#define CLASS_BOX gensym("box")
+
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef min
+#define min MIN
+#endif
+#define CLAMP(a, lo, hi) (((a) < (lo)) ? (lo) : (((a) > (hi)) ? (hi) : (a)))
+
+/****************************************************************
+*  Symbols, atoms and memory
+*/
+t_symbol   *gensym        (const char *s);
+
+short       atom_gettype  (const t_atom *a);
+t_atom_long atom_getlong  (const t_atom *a);
+double      atom_getfloat (const t_atom *a);
+t_symbol   *atom_getsym   (const t_atom *a);
+t_max_err   atom_setlong  (t_atom *a, t_atom_long n);
+t_max_err   atom_setfloat (t_atom *a, double f);
+t_max_err   atom_setsym   (t_atom *a, t_symbol *s);
+
+void *sysmem_newptr      (long size);
+void *sysmem_newptrclear (long size);
+void *sysmem_resizeptr   (void *ptr, long size);
+void  sysmem_freeptr     (void *ptr);
+void  sysmem_copyptr     (const void *src, void *dst, long bytes);
+
+/****************************************************************
+*  Console
+*/
+void post         (const char *fmt, ...);
+void error        (const char *fmt, ...);
+void object_post  (t_object *x, const char *fmt, ...);
+void object_warn  (t_object *x, const char *fmt, ...);
+void object_error (t_object *x, const char *fmt, ...);
+
+/****************************************************************
+*  Classes, objects, inlets and outlets
+*/
+t_class  *class_new       (const char *name, method mnew, method mfree, long size, method mmenu, short type, ...);
+t_max_err class_addmethod (t_class *c, method m, const char *name, ...);
+t_max_err class_register  (t_symbol *space, t_class *c);
+void     *object_alloc    (t_class *c);
+t_max_err object_free     (void *x);
+void      freeobject      (t_object *x);
+void      stdinletinfo    (void);
+
+void     *proxy_new       (void *x, long id, long *stuffloc);
+long      proxy_getinlet  (t_object *x);
+
+void     *outlet_new      (void *x, const char *type);
+void     *outlet_anything (void *o, t_symbol *s, short argc, t_atom *argv);
+
+t_max_err attr_args_process   (void *x, short argc, t_atom *argv);
+long      attr_args_offset    (short argc, t_atom *argv);
+t_max_err object_attr_setlong (void *x, t_symbol *s, t_atom_long n);
+
+/****************************************************************
+*  Scheduler:  qelems, clocks and time
+*/
+t_qelem *qelem_new   (void *x, method fn);
+void     qelem_set   (t_qelem *q);
+void     qelem_unset (t_qelem *q);
+void     qelem_free  (t_qelem *q);
+
+t_clock *clock_new    (void *x, method fn);
+void     clock_fdelay (t_clock *c, double ms);
+void     clock_delay  (t_clock *c, long ms);
+void     clock_unset  (t_clock *c);
+
+double   systimer_gettime (void);
+void     quittask_install (method m, void *a);
+
+/****************************************************************
+*  Hash tables, of objects indexed by symbols
+*/
+t_hashtab *hashtab_new     (long slotcount);
+t_max_err  hashtab_store   (t_hashtab *x, t_symbol *key, t_object *val);
+t_max_err  hashtab_lookup  (t_hashtab *x, t_symbol *key, t_object **val);
+t_max_err  hashtab_chuckkey(t_hashtab *x, t_symbol *key);
+void       hashtab_flags   (t_hashtab *x, long flags);
+long       hashtab_getsize (t_hashtab *x);
+
+/****************************************************************
+*  Stand-in only:  simulation of the scheduler and inspection of the outputs
+*/
+typedef struct _standin_outlet
+{
+  t_object  obj;
+  t_symbol *sym;      // last output
+  long      argc;
+  t_atom   *argv;
+  long      count;    // number of outputs
+  void     *owner;
+  struct _standin_outlet *next;
+} t_standin_outlet;
+
+extern long standin_inlet;     // inlet returned by proxy_getinlet()
+extern long standin_warnings;  // number of warnings and errors posted
+extern int  standin_quiet;     // do not print the console
+
+int  standin_service (void);   // run the qelems set and the clocks due, returns the number run
+void standin_quit    (void);   // run the quit tasks
+
+#endif
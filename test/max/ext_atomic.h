@@ -0,0 +1,18 @@
+/**
+*  @file
+*  Stand-in for the Max SDK:  atomic operations, with the GCC builtins
+*
+*  ATOMIC_INCREMENT and ATOMIC_DECREMENT return the new value,
+*  and ATOMIC_COMPARE_SWAP32 returns true if the value was swapped.
+*/
+
+#ifndef YC_STANDIN_EXT_ATOMIC_H_
+#define YC_STANDIN_EXT_ATOMIC_H_
+
+typedef volatile int32_t t_int32_atomic;
+
+#define ATOMIC_INCREMENT(p)                 __sync_add_and_fetch((p), 1)
+#define ATOMIC_DECREMENT(p)                 __sync_sub_and_fetch((p), 1)
+#define ATOMIC_COMPARE_SWAP32(old, new, p)  __sync_bool_compare_and_swap((p), (old), (new))
+
+#endif
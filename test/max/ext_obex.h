@@ -0,0 +1,36 @@
+/**
+*  @file
+*  Stand-in for the Max SDK:  attributes
+*
+*  The attributes are registered with their type, offset, setter and filter,
+*  and set through attr_args_process() and object_attr_setlong().
+*  The other properties (order, label, style, save) are ignored.
+*/
+
+#ifndef YC_STANDIN_EXT_OBEX_H_
+#define YC_STANDIN_EXT_OBEX_H_
+
+#include "ext.h"
+
+void standin_attr_new      (t_class *c, const char *name, char type, size_t offset);
+void standin_attr_setter   (t_class *c, const char *name, method set);
+void standin_attr_filter   (t_class *c, const char *name, double min, double max);
+
+#define CLASS_ATTR_CHAR(c, name, flags, type, field)       standin_attr_new((c), (name), 'c', offsetof(type, field))
+#define CLASS_ATTR_INT32(c, name, flags, type, field)      standin_attr_new((c), (name), 'i', offsetof(type, field))
+#define CLASS_ATTR_ATOM_LONG(c, name, flags, type, field)  standin_attr_new((c), (name), 'l', offsetof(type, field))
+#define CLASS_ATTR_DOUBLE(c, name, flags, type, field)     standin_attr_new((c), (name), 'd', offsetof(type, field))
+#define CLASS_ATTR_SYM(c, name, flags, type, field)        standin_attr_new((c), (name), 's', offsetof(type, field))
+
+#define CLASS_ATTR_ACCESSORS(c, name, get, set)    standin_attr_setter((c), (name), (method)(set))
+#define CLASS_ATTR_FILTER_CLIP(c, name, min, max)  standin_attr_filter((c), (name), (min), (max))
+#define CLASS_ATTR_FILTER_MIN(c, name, min)        standin_attr_filter((c), (name), (min), 1e300)
+
+#define CLASS_ATTR_ORDER(...)
+#define CLASS_ATTR_LABEL(...)
+#define CLASS_ATTR_STYLE(...)
+#define CLASS_ATTR_ENUMINDEX(...)
+#define CLASS_ATTR_SAVE(...)
+#define CLASS_ATTR_SELFSAVE(...)
+
+#endif
@@ -0,0 +1,30 @@
+/**
+*  @file
+*  Stand-in for the Max SDK:  threads, mutexes and conditions, with pthreads
+*/
+
+#ifndef YC_STANDIN_EXT_SYSTHREAD_H_
+#define YC_STANDIN_EXT_SYSTHREAD_H_
+
+#include "ext.h"
+
+typedef void *t_systhread;
+typedef void *t_systhread_mutex;
+typedef void *t_systhread_cond;
+
+long  systhread_create  (method fn, void *arg, unsigned long stacksize, long priority, long flags, t_systhread *thread);
+long  systhread_join    (t_systhread thread, unsigned int *retval);
+void  systhread_exit    (long status);
+
+long  systhread_mutex_new    (t_systhread_mutex *mutex, long flags);
+long  systhread_mutex_lock   (t_systhread_mutex mutex);
+long  systhread_mutex_unlock (t_systhread_mutex mutex);
+long  systhread_mutex_free   (t_systhread_mutex mutex);
+
+long  systhread_cond_new       (t_systhread_cond *cond, long flags);
+long  systhread_cond_wait      (t_systhread_cond cond, t_systhread_mutex mutex);
+long  systhread_cond_signal    (t_systhread_cond cond);
+long  systhread_cond_broadcast (t_systhread_cond cond);
+long  systhread_cond_free      (t_systhread_cond cond);
+
+#endif
@@ -0,0 +1,705 @@
+/**
+*  @file
+*  Stand-in for the Max SDK, to build and test the externals on Linux
+*
+*  The test program is the main thread. The qelems set from other threads
+*  and the clocks are run on the main thread by standin_service(),
+*  as the Max scheduler would.
+*/
+
+#include "ext.h"
+#include "ext_obex.h"
+#include "ext_systhread.h"
+
+#include <stdarg.h>
+#include <pthread.h>
+#include <time.h>
+
+long standin_inlet = 0;
+long standin_warnings = 0;
+int  standin_quiet = 0;
+
+/****************************************************************
+*  Classes and attributes
+*/
+#define ATTRS_MAX 32
+
+typedef struct _standin_attr
+{
+  t_symbol *name;
+  char      type;
+  size_t    offset;
+  method    set;
+  double    min;
+  double    max;
+} t_standin_attr;
+
+struct _class
+{
+  t_symbol      *name;
+  method         mnew;
+  method         mfree;
+  long           size;
+  t_standin_attr attrs[ATTRS_MAX];
+  long           attr_cnt;
+};
+
+/****************************************************************
+*  Symbols
+*/
+typedef struct _standin_sym
+{
+  t_symbol sym;
+  struct _standin_sym *next;
+} t_standin_sym;
+
+static t_standin_sym  *syms = NULL;
+static pthread_mutex_t syms_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+t_symbol *gensym(const char *s)
+{
+  t_standin_sym *item;
+
+  pthread_mutex_lock(&syms_mutex);
+  for (item = syms; item; item = item->next) {
+    if (!strcmp(item->sym.s_name, s)) { break; } }
+  if (!item) {
+    item = (t_standin_sym *)calloc(1, sizeof(t_standin_sym));
+    item->sym.s_name = strdup(s);
+    item->next = syms;
+    syms = item;
+  }
+  pthread_mutex_unlock(&syms_mutex);
+
+  return &item->sym;
+}
+
+/****************************************************************
+*  Atoms
+*/
+short atom_gettype(const t_atom *a)
+{
+  return a->a_type;
+}
+
+t_atom_long atom_getlong(const t_atom *a)
+{
+  switch (a->a_type) {
+  case A_LONG:  return a->a_w.w_long;
+  case A_FLOAT: return (t_atom_long)a->a_w.w_float;
+  default:      return 0;
+  }
+}
+
+double atom_getfloat(const t_atom *a)
+{
+  switch (a->a_type) {
+  case A_LONG:  return (double)a->a_w.w_long;
+  case A_FLOAT: return a->a_w.w_float;
+  default:      return 0;
+  }
+}
+
+t_symbol *atom_getsym(const t_atom *a)
+{
+  return (a->a_type == A_SYM) ? a->a_w.w_sym : gensym("");
+}
+
+t_max_err atom_setlong(t_atom *a, t_atom_long n)
+{
+  a->a_type = A_LONG;
+  a->a_w.w_long = n;
+  return MAX_ERR_NONE;
+}
+
+t_max_err atom_setfloat(t_atom *a, double f)
+{
+  a->a_type = A_FLOAT;
+  a->a_w.w_float = f;
+  return MAX_ERR_NONE;
+}
+
+t_max_err atom_setsym(t_atom *a, t_symbol *s)
+{
+  a->a_type = A_SYM;
+  a->a_w.w_sym = s;
+  return MAX_ERR_NONE;
+}
+
+/****************************************************************
+*  Memory
+*/
+void *sysmem_newptr(long size)
+{
+  return malloc((size_t)(size ? size : 1));
+}
+
+void *sysmem_newptrclear(long size)
+{
+  return calloc(1, (size_t)(size ? size : 1));
+}
+
+void *sysmem_resizeptr(void *ptr, long size)
+{
+  return realloc(ptr, (size_t)(size ? size : 1));
+}
+
+void sysmem_freeptr(void *ptr)
+{
+  free(ptr);
+}
+
+void sysmem_copyptr(const void *src, void *dst, long bytes)
+{
+  memmove(dst, src, (size_t)bytes);
+}
+
+/****************************************************************
+*  Console
+*/
+static void standin_print(const char *prefix, const char *fmt, va_list args)
+{
+  if (standin_quiet) { return; }
+  fprintf(stderr, "%s", prefix);
+  vfprintf(stderr, fmt, args);
+  fprintf(stderr, "\n");
+}
+
+void post(const char *fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt); standin_print("", fmt, args); va_end(args);
+}
+
+void error(const char *fmt, ...)
+{
+  va_list args;
+  standin_warnings++;
+  va_start(args, fmt); standin_print("error: ", fmt, args); va_end(args);
+}
+
+void object_post(t_object *x, const char *fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt); standin_print("", fmt, args); va_end(args);
+}
+
+void object_warn(t_object *x, const char *fmt, ...)
+{
+  va_list args;
+  standin_warnings++;
+  va_start(args, fmt); standin_print("warning: ", fmt, args); va_end(args);
+}
+
+void object_error(t_object *x, const char *fmt, ...)
+{
+  va_list args;
+  standin_warnings++;
+  va_start(args, fmt); standin_print("error: ", fmt, args); va_end(args);
+}
+
+/****************************************************************
+*  Classes and objects
+*
+*  The stand-in objects (outlets, proxies, qelems, clocks) also start
+*  with a t_object, whose class holds the function that frees them.
+*/
+t_class *class_new(const char *name, method mnew, method mfree, long size, method mmenu, short type, ...)
+{
+  t_class *c = (t_class *)calloc(1, sizeof(t_class));
+  c->name = gensym(name);
+  c->mnew = mnew;
+  c->mfree = mfree;
+  c->size = size;
+  return c;
+}
+
+t_max_err class_addmethod(t_class *c, method m, const char *name, ...)
+{
+  return MAX_ERR_NONE;
+}
+
+t_max_err class_register(t_symbol *space, t_class *c)
+{
+  return MAX_ERR_NONE;
+}
+
+void *object_alloc(t_class *c)
+{
+  t_object *x = (t_object *)calloc(1, (size_t)c->size);
+  if (x) { x->o_messlist = c; }
+  return x;
+}
+
+static void standin_outlets_free(void *owner);
+
+t_max_err object_free(void *x)
+{
+  if (!x) { return MAX_ERR_INVALID_PTR; }
+
+  t_class *c = (t_class *)((t_object *)x)->o_messlist;
+  if (c && c->mfree) { c->mfree(x); }
+  standin_outlets_free(x);
+  free(x);
+  return MAX_ERR_NONE;
+}
+
+void freeobject(t_object *x)
+{
+  object_free(x);
+}
+
+void stdinletinfo(void)
+{
+}
+
+/****************************************************************
+*  Inlets and outlets
+*
+*  The outlets are freed with the object that owns them.
+*/
+static t_class standin_proxy_class = { NULL };
+static t_class standin_outlet_class = { NULL };
+static t_standin_outlet *outlets = NULL;
+
+void *proxy_new(void *x, long id, long *stuffloc)
+{
+  t_object *p = (t_object *)calloc(1, sizeof(t_object));
+  p->o_messlist = &standin_proxy_class;
+  return p;
+}
+
+long proxy_getinlet(t_object *x)
+{
+  return standin_inlet;
+}
+
+static void standin_outlet_free(t_standin_outlet *o)
+{
+  free(o->argv);
+}
+
+static void standin_outlets_free(void *owner)
+{
+  t_standin_outlet **p = &outlets, *o;
+
+  while ((o = *p)) {
+    if (o->owner == owner) { *p = o->next; object_free(o); }
+    else { p = &o->next; }
+  }
+}
+
+void *outlet_new(void *x, const char *type)
+{
+  t_standin_outlet *o = (t_standin_outlet *)calloc(1, sizeof(t_standin_outlet));
+  standin_outlet_class.mfree = (method)standin_outlet_free;
+  o->obj.o_messlist = &standin_outlet_class;
+  o->owner = x;
+  o->next = outlets;
+  outlets = o;
+  return o;
+}
+
+void *outlet_anything(void *o, t_symbol *s, short argc, t_atom *argv)
+{
+  t_standin_outlet *outl = (t_standin_outlet *)o;
+
+  outl->argv = (t_atom *)realloc(outl->argv, sizeof(t_atom) * (size_t)(argc ? argc : 1));
+  memcpy(outl->argv, argv, sizeof(t_atom) * (size_t)argc);
+  outl->argc = argc;
+  outl->sym = s;
+  outl->count++;
+  return NULL;
+}
+
+/****************************************************************
+*  Attributes
+*/
+static t_standin_attr *standin_attr_find(t_class *c, t_symbol *name)
+{
+  for (long i = 0; i < c->attr_cnt; i++) {
+    if (c->attrs[i].name == name) { return c->attrs + i; } }
+  return NULL;
+}
+
+void standin_attr_new(t_class *c, const char *name, char type, size_t offset)
+{
+  if (c->attr_cnt == ATTRS_MAX) { return; }
+
+  t_standin_attr *attr = c->attrs + c->attr_cnt++;
+  attr->name = gensym(name);
+  attr->type = type;
+  attr->offset = offset;
+  attr->set = NULL;
+  attr->min = -1e300;
+  attr->max = 1e300;
+}
+
+void standin_attr_setter(t_class *c, const char *name, method set)
+{
+  t_standin_attr *attr = standin_attr_find(c, gensym(name));
+  if (attr) { attr->set = set; }
+}
+
+void standin_attr_filter(t_class *c, const char *name, double min, double max)
+{
+  t_standin_attr *attr = standin_attr_find(c, gensym(name));
+  if (attr) { attr->min = min; attr->max = max; }
+}
+
+static t_max_err standin_attr_set(void *x, t_symbol *name, long argc, t_atom *argv)
+{
+  t_class *c = (t_class *)((t_object *)x)->o_messlist;
+  t_standin_attr *attr = standin_attr_find(c, name);
+  if (!attr || !argc) { return MAX_ERR_GENERIC; }
+
+  // Filter the value
+  t_atom atom[1];
+  if (attr->type == 's') { *atom = *argv; }
+  else { atom_setfloat(atom, CLAMP(atom_getfloat(argv), attr->min, attr->max)); }
+  if ((attr->type != 's') && (attr->type != 'd')) { atom_setlong(atom, (t_atom_long)atom_getfloat(atom)); }
+
+  if (attr->set) { return (t_max_err)(t_ptr_int)attr->set(x, attr, 1L, atom); }
+
+  char *field = (char *)x + attr->offset;
+  switch (attr->type) {
+  case 'c': *(char *)field = (char)atom_getlong(atom); break;
+  case 'i': *(t_int32 *)field = (t_int32)atom_getlong(atom); break;
+  case 'l': *(t_atom_long *)field = atom_getlong(atom); break;
+  case 'd': *(double *)field = atom_getfloat(atom); break;
+  case 's': *(t_symbol **)field = atom_getsym(atom); break;
+  }
+  return MAX_ERR_NONE;
+}
+
+long attr_args_offset(short argc, t_atom *argv)
+{
+  long i;
+  for (i = 0; i < argc; i++) {
+    if ((argv[i].a_type == A_SYM) && (argv[i].a_w.w_sym->s_name[0] == '@')) { break; } }
+  return i;
+}
+
+t_max_err attr_args_process(void *x, short argc, t_atom *argv)
+{
+  long beg = attr_args_offset(argc, argv);
+  long end;
+
+  while (beg < argc) {
+    end = beg + 1 + attr_args_offset((short)(argc - beg - 1), argv + beg + 1);
+    standin_attr_set(x, gensym(argv[beg].a_w.w_sym->s_name + 1), end - beg - 1, argv + beg + 1);
+    beg = end;
+  }
+  return MAX_ERR_NONE;
+}
+
+t_max_err object_attr_setlong(void *x, t_symbol *s, t_atom_long n)
+{
+  t_atom atom[1];
+  atom_setlong(atom, n);
+  return standin_attr_set(x, s, 1, atom);
+}
+
+/****************************************************************
+*  Threads
+*/
+long systhread_create(method fn, void *arg, unsigned long stacksize, long priority, long flags, t_systhread *thread)
+{
+  pthread_t *th = (pthread_t *)malloc(sizeof(pthread_t));
+  if (!th) { return 1; }
+  if (pthread_create(th, NULL, (void *(*)(void *))fn, arg)) { free(th); return 1; }
+  *thread = th;
+  return 0;
+}
+
+long systhread_join(t_systhread thread, unsigned int *retval)
+{
+  pthread_t *th = (pthread_t *)thread;
+  long err = pthread_join(*th, NULL);
+  free(th);
+  if (retval) { *retval = 0; }
+  return err;
+}
+
+void systhread_exit(long status)
+{
+  pthread_exit(NULL);
+}
+
+long systhread_mutex_new(t_systhread_mutex *mutex, long flags)
+{
+  pthread_mutex_t *m = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t));
+  if (m && pthread_mutex_init(m, NULL)) { free(m); m = NULL; }
+  *mutex = m;
+  return m ? 0 : 1;
+}
+
+long systhread_mutex_lock(t_systhread_mutex mutex)
+{
+  return pthread_mutex_lock((pthread_mutex_t *)mutex);
+}
+
+long systhread_mutex_unlock(t_systhread_mutex mutex)
+{
+  return pthread_mutex_unlock((pthread_mutex_t *)mutex);
+}
+
+long systhread_mutex_free(t_systhread_mutex mutex)
+{
+  long err = pthread_mutex_destroy((pthread_mutex_t *)mutex);
+  free(mutex);
+  return err;
+}
+
+long systhread_cond_new(t_systhread_cond *cond, long flags)
+{
+  pthread_cond_t *c = (pthread_cond_t *)malloc(sizeof(pthread_cond_t));
+  if (c && pthread_cond_init(c, NULL)) { free(c); c = NULL; }
+  *cond = c;
+  return c ? 0 : 1;
+}
+
+long systhread_cond_wait(t_systhread_cond cond, t_systhread_mutex mutex)
+{
+  return pthread_cond_wait((pthread_cond_t *)cond, (pthread_mutex_t *)mutex);
+}
+
+long systhread_cond_signal(t_systhread_cond cond)
+{
+  return pthread_cond_signal((pthread_cond_t *)cond);
+}
+
+long systhread_cond_broadcast(t_systhread_cond cond)
+{
+  return pthread_cond_broadcast((pthread_cond_t *)cond);
+}
+
+long systhread_cond_free(t_systhread_cond cond)
+{
+  long err = pthread_cond_destroy((pthread_cond_t *)cond);
+  free(cond);
+  return err;
+}
+
+/****************************************************************
+*  Scheduler
+*
+*  The qelems and clocks are kept in a list, and run by standin_service().
+*  A qelem can be set from any thread, and runs once however many times it was set.
+*/
+typedef struct _standin_task
+{
+  t_object obj;
+  void    *x;
+  method   fn;
+  int      set;
+  double   due;     // clocks only
+  int      clock;
+  struct _standin_task *next;
+} t_standin_task;
+
+struct _qelem { t_standin_task task; };
+struct _clock { t_standin_task task; };
+
+static t_standin_task *tasks = NULL;
+static pthread_mutex_t tasks_mutex = PTHREAD_MUTEX_INITIALIZER;
+static t_class standin_task_class = { NULL };
+
+static void standin_task_free(t_standin_task *t)
+{
+  t_standin_task **p;
+
+  pthread_mutex_lock(&tasks_mutex);
+  for (p = &tasks; *p; p = &(*p)->next) {
+    if (*p == t) { *p = t->next; break; } }
+  pthread_mutex_unlock(&tasks_mutex);
+}
+
+static t_standin_task *standin_task_new(void *x, method fn, int clock)
+{
+  t_standin_task *t = (t_standin_task *)calloc(1, sizeof(t_standin_task));
+  standin_task_class.mfree = (method)standin_task_free;
+  t->obj.o_messlist = &standin_task_class;
+  t->x = x;
+  t->fn = fn;
+  t->clock = clock;
+
+  pthread_mutex_lock(&tasks_mutex);
+  t->next = tasks;
+  tasks = t;
+  pthread_mutex_unlock(&tasks_mutex);
+  return t;
+}
+
+t_qelem *qelem_new(void *x, method fn)
+{
+  return (t_qelem *)standin_task_new(x, fn, 0);
+}
+
+void qelem_set(t_qelem *q)
+{
+  pthread_mutex_lock(&tasks_mutex);
+  q->task.set = 1;
+  pthread_mutex_unlock(&tasks_mutex);
+}
+
+void qelem_unset(t_qelem *q)
+{
+  pthread_mutex_lock(&tasks_mutex);
+  q->task.set = 0;
+  pthread_mutex_unlock(&tasks_mutex);
+}
+
+void qelem_free(t_qelem *q)
+{
+  object_free(q);
+}
+
+t_clock *clock_new(void *x, method fn)
+{
+  return (t_clock *)standin_task_new(x, fn, 1);
+}
+
+void clock_fdelay(t_clock *c, double ms)
+{
+  pthread_mutex_lock(&tasks_mutex);
+  c->task.set = 1;
+  c->task.due = systimer_gettime() + ms;
+  pthread_mutex_unlock(&tasks_mutex);
+}
+
+void clock_delay(t_clock *c, long ms)
+{
+  clock_fdelay(c, (double)ms);
+}
+
+void clock_unset(t_clock *c)
+{
+  pthread_mutex_lock(&tasks_mutex);
+  c->task.set = 0;
+  pthread_mutex_unlock(&tasks_mutex);
+}
+
+double systimer_gettime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+int standin_service(void)
+{
+  t_standin_task *t;
+  int cnt = 0;
+
+  // Run one task at a time, without the lock, as it may set or free tasks
+  while (true) {
+    double now = systimer_gettime();
+
+    pthread_mutex_lock(&tasks_mutex);
+    for (t = tasks; t; t = t->next) {
+      if (t->set && (!t->clock || (t->due <= now))) { t->set = 0; break; } }
+    pthread_mutex_unlock(&tasks_mutex);
+
+    if (!t) { return cnt; }
+    t->fn(t->x);
+    cnt++;
+  }
+}
+
+/****************************************************************
+*  Quit tasks
+*/
+#define QUITTASKS_MAX 8
+
+static method quit_fns[QUITTASKS_MAX];
+static void  *quit_args[QUITTASKS_MAX];
+static int    quit_cnt = 0;
+
+void quittask_install(method m, void *a)
+{
+  if (quit_cnt == QUITTASKS_MAX) { return; }
+  quit_fns[quit_cnt] = m;
+  quit_args[quit_cnt++] = a;
+}
+
+void standin_quit(void)
+{
+  while (quit_cnt) {
+    quit_cnt--;
+    quit_fns[quit_cnt](quit_args[quit_cnt]);
+  }
+}
+
+/****************************************************************
+*  Hash tables, as lists
+*/
+typedef struct _standin_entry
+{
+  t_symbol *key;
+  t_object *val;
+  struct _standin_entry *next;
+} t_standin_entry;
+
+struct _hashtab
+{
+  t_object obj;
+  t_standin_entry *entries;
+  long size;
+};
+
+static void standin_hashtab_free(t_hashtab *x)
+{
+  t_standin_entry *e;
+  while ((e = x->entries)) { x->entries = e->next; free(e); }
+}
+
+static t_class standin_hashtab_class = { NULL };
+
+t_hashtab *hashtab_new(long slotcount)
+{
+  t_hashtab *x = (t_hashtab *)calloc(1, sizeof(t_hashtab));
+  standin_hashtab_class.mfree = (method)standin_hashtab_free;
+  x->obj.o_messlist = &standin_hashtab_class;
+  return x;
+}
+
+t_max_err hashtab_store(t_hashtab *x, t_symbol *key, t_object *val)
+{
+  t_standin_entry *e;
+  for (e = x->entries; e; e = e->next) {
+    if (e->key == key) { e->val = val; return MAX_ERR_NONE; } }
+
+  e = (t_standin_entry *)calloc(1, sizeof(t_standin_entry));
+  e->key = key;
+  e->val = val;
+  e->next = x->entries;
+  x->entries = e;
+  x->size++;
+  return MAX_ERR_NONE;
+}
+
+t_max_err hashtab_lookup(t_hashtab *x, t_symbol *key, t_object **val)
+{
+  for (t_standin_entry *e = x->entries; e; e = e->next) {
+    if (e->key == key) { *val = e->val; return MAX_ERR_NONE; } }
+  *val = NULL;
+  return MAX_ERR_GENERIC;
+}
+
+t_max_err hashtab_chuckkey(t_hashtab *x, t_symbol *key)
+{
+  t_standin_entry **p, *e;
+  for (p = &x->entries; *p; p = &(*p)->next) {
+    if ((*p)->key == key) { e = *p; *p = e->next; free(e); x->size--; return MAX_ERR_NONE; } }
+  return MAX_ERR_GENERIC;
+}
+
+void hashtab_flags(t_hashtab *x, long flags)
+{
+}
+
+long hashtab_getsize(t_hashtab *x)
+{
+  return x->size;
+}
@@ -0,0 +1,352 @@
+/**
+*  @file
+*  Tests of the element-wise engine, with Lmax and the stand-in for the Max SDK
+*
+*  Mostly the async attribute:  the output of the worker is delivered by its qelem
+*  when the test services the scheduler, as Max would on the main thread.
+*/
+
+#include "ext.h"
+#include "ext_obex.h"
+#include "Lobjects.h"
+#include "Lelem.h"
+
+#include <unistd.h>
+
+void ext_main(void *r);
+
+/****************************************************************
+*  Test helpers
+*/
+static int failures = 0;
+
+#define CHECK(cond) \
+  if (!(cond)) { failures++; fprintf(stderr, "FAILED %s:%d:  %s\n", __FILE__, __LINE__, #cond); }
+
+#define LEN 4096
+#define TIMEOUT 5000.0
+
+static t_atom atoms[LEN];
+
+static t_lelem *lmax_new(const char *attrs)
+{
+  t_atom argv[16];
+  short argc = 0;
+  char buf[256], *tok;
+
+  strncpy(buf, attrs, sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+  for (tok = strtok(buf, " "); tok && (argc < 16); tok = strtok(NULL, " ")) {
+    if (tok[0] == '@') { atom_setsym(argv + argc++, gensym(tok)); }
+    else { atom_setlong(argv + argc++, atol(tok)); }
+  }
+  return (t_lelem *)lelem_new(gensym("Lmax"), argc, argv);
+}
+
+static t_standin_outlet *outlet(t_lelem *x)
+{
+  return (t_standin_outlet *)x->outl_list;
+}
+
+// Send the list:  base + i * step
+static void send_ramp(t_lelem *x, long inlet, t_mess_int len, long base, long step)
+{
+  for (t_mess_int i = 0; i < len; i++) { atom_setlong(atoms + i, base + i * step); }
+  standin_inlet = inlet;
+  lelem_list(x, gensym("list"), len, atoms);
+  standin_inlet = 0;
+}
+
+static void send_bang(t_lelem *x)
+{
+  lelem_bang(x);
+}
+
+// Service the scheduler until the number of outputs is reached, returns false on timeout
+static t_bool wait_outputs(t_lelem *x, long count)
+{
+  double end = systimer_gettime() + TIMEOUT;
+  while (outlet(x)->count < count) {
+    standin_service();
+    if (systimer_gettime() > end) { return false; }
+    usleep(100);
+  }
+  return true;
+}
+
+// Service the scheduler until the last request is delivered, returns false on timeout
+static t_bool wait_idle(t_lelem *x)
+{
+  double end = systimer_gettime() + TIMEOUT;
+  while (true) {
+    standin_service();
+    if (!x->worker->thread) { return true; }
+    worker_lock(x->worker);
+    t_bool idle = !worker_busy(x->worker) && !x->worker->ready;
+    worker_unlock(x->worker);
+    if (idle) { standin_service(); return true; }
+    if (systimer_gettime() > end) { return false; }
+    usleep(100);
+  }
+}
+
+// Test the last output against:  max(base0 + i * step0, base1 + i * step1)
+static t_bool output_is(t_lelem *x, t_mess_int len, long base0, long step0, long base1, long step1)
+{
+  t_standin_outlet *o = outlet(x);
+  if ((o->argc != len) || (o->sym != gensym("list"))) { return false; }
+  for (t_mess_int i = 0; i < len; i++) {
+    if (atom_getlong(o->argv + i) != MAX(base0 + i * step0, base1 + i * step1)) { return false; } }
+  return true;
+}
+
+/****************************************************************
+*  Hot inputs are processed by the worker, and output when delivered
+*/
+static void test_async_hot(void)
+{
+  t_lelem *x = lmax_new("@maxlen 4096 @async 1000");
+
+  send_ramp(x, 1, LEN, 0, 1);
+  send_ramp(x, 0, LEN, LEN, -1);
+  CHECK(outlet(x)->count == 0);
+  CHECK(wait_outputs(x, 1));
+  CHECK(output_is(x, LEN, LEN, -1, 0, 1));
+
+  // Bang outputs the delivered result
+  send_bang(x);
+  CHECK(outlet(x)->count == 2);
+  CHECK(output_is(x, LEN, LEN, -1, 0, 1));
+
+  // Short lists are processed synchronously
+  send_ramp(x, 0, 10, 100, 0);
+  CHECK(outlet(x)->count == 3);
+  CHECK(wait_idle(x));
+  CHECK(outlet(x)->count == 3);
+
+  object_free(x);
+}
+
+/****************************************************************
+*  Cold inputs recompute in the worker without output,
+*  and bang outputs the latest delivered result
+*/
+static void test_async_cold(void)
+{
+  t_lelem *x = lmax_new("@maxlen 4096 @async 1000");
+
+  send_ramp(x, 1, LEN, 0, 1);
+  send_ramp(x, 0, LEN, LEN, -1);
+  CHECK(wait_outputs(x, 1));
+
+  // The output list is not computed synchronously
+  t_uint32 stamp = x->o_stamp;
+  send_ramp(x, 1, LEN, 5000, 1);
+  CHECK(x->o_stamp == stamp);
+  CHECK(wait_idle(x));
+  CHECK(outlet(x)->count == 1);
+
+  send_bang(x);
+  CHECK(outlet(x)->count == 2);
+  CHECK(output_is(x, LEN, LEN, -1, 5000, 1));
+
+  // The delivered result is kept when async is turned off
+  object_attr_setlong(x, gensym("async"), 0);
+  send_bang(x);
+  CHECK(outlet(x)->count == 3);
+  CHECK(output_is(x, LEN, LEN, -1, 5000, 1));
+
+  // ... and a synchronous computation is more recent than a stale delivery
+  object_attr_setlong(x, gensym("async"), 1000);
+  send_ramp(x, 1, LEN, 7000, 1);
+  CHECK(wait_idle(x));
+  send_ramp(x, 0, 10, 9000, 0);
+  CHECK(outlet(x)->count == 4);
+  send_bang(x);
+  CHECK(outlet(x)->count == 5);
+  CHECK(output_is(x, 10, 9000, 0, 7000, 1));
+
+  object_free(x);
+}
+
+/****************************************************************
+*  With requests dropped when busy, the latest request is output last
+*/
+static void test_async_drop(void)
+{
+  t_lelem *x = lmax_new("@maxlen 4096 @async 1000 @drop 0");
+
+  send_ramp(x, 1, LEN, 0, 0);
+  for (long k = 1; k <= 20; k++) { send_ramp(x, 0, LEN, k * 10000, 1); }
+  CHECK(wait_idle(x));
+  CHECK(outlet(x)->count >= 1);
+  CHECK(outlet(x)->count <= 20);
+  CHECK(output_is(x, LEN, 20 * 10000, 1, 0, 0));
+
+  // A cold input replacing a hot request still outputs, and bang outputs the latest
+  long count = outlet(x)->count;
+  send_ramp(x, 0, LEN, 1, 0);
+  send_ramp(x, 1, LEN, 2, 0);
+  CHECK(wait_idle(x));
+  CHECK(outlet(x)->count >= count + 1);
+  send_bang(x);
+  CHECK(output_is(x, LEN, 2, 0, 0, 0));
+
+  object_free(x);
+}
+
+/****************************************************************
+*  The setters of the attributes keep the stored lists
+*/
+static void test_setters_keep_lists(void)
+{
+  const char *attrs[] = { "largepages", "inbox", "async", "precision" };
+  const long vals[] = { 1, 1, 2, 32 };
+  t_lelem *x = lmax_new("@maxlen 100");
+  long count = 0;
+
+  send_ramp(x, 1, 3, 1, 1);
+  for (int k = 0; k < 4; k++) {
+    object_attr_setlong(x, gensym(attrs[k]), vals[k]);
+
+    // The right list is kept:  1 2 3
+    send_ramp(x, 0, 3, 0, 0);
+    CHECK(wait_outputs(x, ++count));
+    CHECK(output_is(x, 3, 0, 0, 1, 1));
+
+    // ... as well as the output list
+    send_bang(x);
+    CHECK(wait_outputs(x, ++count));
+    CHECK(output_is(x, 3, 0, 0, 1, 1));
+  }
+
+  for (int k = 3; k >= 0; k--) {
+    object_attr_setlong(x, gensym(attrs[k]), k == 3 ? 64 : 0);
+    send_bang(x);
+    CHECK(wait_outputs(x, ++count));
+    CHECK(output_is(x, 3, 0, 0, 1, 1));
+  }
+
+  object_free(x);
+}
+
+/****************************************************************
+*  Clear on a new object, before the lists are allocated
+*/
+static void test_clear_new(void)
+{
+  t_lelem *x = lmax_new("");
+
+  CHECK(x->alloc_pending);
+  lelem_clear(x);
+  CHECK(!x->alloc_pending);
+  send_bang(x);
+  CHECK(outlet(x)->count == 0);
+
+  send_ramp(x, 0, 3, 1, 1);
+  CHECK(outlet(x)->count == 1);
+  CHECK(output_is(x, 3, 1, 1, 0, 0));
+
+  object_free(x);
+}
+
+/****************************************************************
+*  Packed lists are zero beyond their length, when a cold list shrinks
+*/
+static void test_precision_tail(void)
+{
+  t_lelem *x = lmax_new("@maxlen 100 @precision 32");
+
+  send_ramp(x, 1, 8, 5, 0);
+  send_ramp(x, 1, 2, 1, 0);
+  send_ramp(x, 0, 8, 0, 0);
+  CHECK(x->p_valid[1] && (x->p_len[1] == 2));
+  CHECK(outlet(x)->count == 1);
+  CHECK((outlet(x)->argc == 8) && (atom_gettype(outlet(x)->argv) == A_FLOAT));
+  for (long i = 0; i < 8; i++) { CHECK(atom_getfloat(outlet(x)->argv + i) == (i < 2 ? 1 : 0)); }
+
+  object_free(x);
+}
+
+/****************************************************************
+*  The output of a batch of frames is not truncated to the maximum length
+*/
+static void test_frames(void)
+{
+  t_lelem *x = lmax_new("@maxlen 100");
+  long warnings = standin_warnings;
+
+  send_ramp(x, 1, 1, 50, 0);
+
+  // frames 100 <4 ramps of 100>
+  atom_setlong(atoms, 100);
+  for (t_mess_int i = 0; i < 400; i++) { atom_setlong(atoms + 1 + i, i % 100); }
+  lelem_frames(x, gensym("frames"), 401, atoms);
+  CHECK(outlet(x)->count == 1);
+  CHECK(standin_warnings == warnings);
+  t_bool same = (outlet(x)->argc == 400);
+  for (long i = 0; same && (i < 400); i++) { same = (atom_getlong(outlet(x)->argv + i) == MAX(i % 100, 50)); }
+  CHECK(same);
+
+  object_free(x);
+}
+
+/****************************************************************
+*  With a precision of 32, the worker and the processing over several ticks
+*  give the same output as the synchronous processing
+*/
+static t_bool same_output(t_lelem *x, t_lelem *y)
+{
+  t_standin_outlet *o = outlet(x), *p = outlet(y);
+  if ((o->argc != p->argc) || (o->sym != p->sym)) { return false; }
+  for (long i = 0; i < o->argc; i++) {
+    if (atom_gettype(o->argv + i) != atom_gettype(p->argv + i)) { return false; }
+    if (atom_getfloat(o->argv + i) != atom_getfloat(p->argv + i)) { return false; }
+  }
+  return true;
+}
+
+static void test_async_precision(void)
+{
+  const char *attrs[] = { "@maxlen 4096 @precision 32 @async 1000", "@maxlen 4096 @precision 32 @budget 1" };
+  t_lelem *y = lmax_new("@maxlen 4096 @precision 32");
+
+  // Ints beyond the precision of 32 bit floats:  2^24 + 1 + i
+  send_ramp(y, 1, LEN / 2, 0, 1);
+  send_ramp(y, 0, LEN, 16777217, 1);
+  CHECK(atom_gettype(outlet(y)->argv) == A_FLOAT);
+
+  for (int k = 0; k < 2; k++) {
+    t_lelem *x = lmax_new(attrs[k]);
+    send_ramp(x, 1, LEN / 2, 0, 1);
+    send_ramp(x, 0, LEN, 16777217, 1);
+    CHECK(wait_outputs(x, 1));
+    CHECK(same_output(x, y));
+    object_free(x);
+  }
+
+  object_free(y);
+}
+
+/****************************************************************
+*  Main
+*/
+int main(void)
+{
+  ext_main(NULL);
+
+  test_async_hot();
+  test_async_cold();
+  test_async_drop();
+  test_setters_keep_lists();
+  test_clear_new();
+  test_precision_tail();
+  test_async_precision();
+  test_frames();
+
+  standin_quit();
+
+  if (failures) { fprintf(stderr, "%i check(s) failed\n", failures); return 1; }
+  fprintf(stderr, "All tests passed\n");
+  return 0;
+}